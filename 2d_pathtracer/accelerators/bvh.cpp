@@ -0,0 +1,297 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+	constexpr int NUM_BINS = 12;
+	//leaves are only created by the SAH below this size, bigger nodes are always split
+	constexpr uint32_t MAX_LEAF_SIZE = 8;
+	//keep the depth below the traversal stack size
+	constexpr uint32_t MAX_DEPTH = 48;
+	//cost of one traversal step relative to one primitive intersection
+	constexpr float TRAVERSAL_COST = 1.0f;
+	//a subtree is rebuilt once a refit made its bounds twice as large as after the build
+	constexpr float REBUILD_THRESHOLD = 2.0f;
+	constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+	struct Bin
+	{
+		AABB bounds;
+		uint32_t count = 0;
+	};
+}
+
+void BVH::build(const std::vector<AABB>& prim_bounds)
+{
+	clear();
+	if (prim_bounds.empty())
+	{
+		return;
+	}
+
+	const auto num_prims = static_cast<uint32_t>(prim_bounds.size());
+	m_prim_bounds = prim_bounds;
+	m_prim_indices.resize(num_prims);
+	std::iota(m_prim_indices.begin(), m_prim_indices.end(), 0u);
+	m_prim_leaf.resize(num_prims);
+
+	//a binary tree has at most 2n - 1 nodes
+	m_nodes.reserve(2 * num_prims - 1);
+	Node root;
+	root.left_first = 0;
+	root.count = num_prims;
+	m_nodes.push_back(root);
+	m_parents.push_back(INVALID_INDEX);
+	m_depths.push_back(0);
+	m_build_area.push_back(0.0f);
+	update_bounds(0);
+	subdivide(0);
+}
+
+void BVH::clear()
+{
+	m_nodes.clear();
+	m_prim_indices.clear();
+	m_prim_bounds.clear();
+	m_parents.clear();
+	m_depths.clear();
+	m_build_area.clear();
+	m_prim_leaf.clear();
+	m_unused_nodes = 0;
+}
+
+void BVH::update_bounds(uint32_t node_index)
+{
+	Node& node = m_nodes[node_index];
+	node.bounds = AABB();
+	for (uint32_t i = 0; i < node.count; ++i)
+	{
+		const uint32_t prim = m_prim_indices[node.left_first + i];
+		node.bounds.grow(m_prim_bounds[prim]);
+		m_prim_leaf[prim] = node_index;
+	}
+	m_build_area[node_index] = node.bounds.half_perimeter();
+}
+
+float BVH::find_best_split(const Node& node, int& axis, float& split_pos) const
+{
+	float best_cost = std::numeric_limits<float>::max();
+
+	AABB centroids;
+	for (uint32_t i = 0; i < node.count; ++i)
+	{
+		centroids.grow(m_prim_bounds[m_prim_indices[node.left_first + i]].center());
+	}
+
+	for (int a = 0; a < 2; ++a)
+	{
+		const float lo = centroids.min[a];
+		const float hi = centroids.max[a];
+		if (lo == hi)
+		{
+			continue;
+		}
+
+		//sort centroids into bins
+		Bin bins[NUM_BINS];
+		const float scale = NUM_BINS / (hi - lo);
+		for (uint32_t i = 0; i < node.count; ++i)
+		{
+			const AABB& box = m_prim_bounds[m_prim_indices[node.left_first + i]];
+			const int bin = std::min(NUM_BINS - 1, static_cast<int>((box.center()[a] - lo) * scale));
+			bins[bin].count++;
+			bins[bin].bounds.grow(box);
+		}
+
+		//sweep from both sides to get the cost of every plane between two bins
+		float left_area[NUM_BINS - 1], right_area[NUM_BINS - 1];
+		uint32_t left_count[NUM_BINS - 1], right_count[NUM_BINS - 1];
+		AABB left_box, right_box;
+		uint32_t left_sum = 0, right_sum = 0;
+		for (int i = 0; i < NUM_BINS - 1; ++i)
+		{
+			left_sum += bins[i].count;
+			left_count[i] = left_sum;
+			left_box.grow(bins[i].bounds);
+			left_area[i] = left_box.half_perimeter();
+
+			right_sum += bins[NUM_BINS - 1 - i].count;
+			right_count[NUM_BINS - 2 - i] = right_sum;
+			right_box.grow(bins[NUM_BINS - 1 - i].bounds);
+			right_area[NUM_BINS - 2 - i] = right_box.half_perimeter();
+		}
+
+		const float bin_width = (hi - lo) / NUM_BINS;
+		for (int i = 0; i < NUM_BINS - 1; ++i)
+		{
+			const float cost = left_count[i] * left_area[i] + right_count[i] * right_area[i];
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				axis = a;
+				split_pos = lo + bin_width * (i + 1);
+			}
+		}
+	}
+	return best_cost;
+}
+
+void BVH::subdivide(uint32_t node_index)
+{
+	const Node node = m_nodes[node_index];
+	const uint32_t depth = m_depths[node_index];
+	if (node.count <= 1 || depth >= MAX_DEPTH)
+	{
+		return;
+	}
+
+	int axis = -1;
+	float split_pos = 0.0f;
+	const float split_cost = find_best_split(node, axis, split_pos);
+
+	//all centroids are at the same position, splitting does not help
+	if (axis < 0)
+	{
+		return;
+	}
+
+	//SAH: compare the split with intersecting all primitives of this node
+	const float area = node.bounds.half_perimeter();
+	const float leaf_cost = static_cast<float>(node.count);
+	const float cost = area > 0.0f ? TRAVERSAL_COST + split_cost / area : TRAVERSAL_COST;
+	if (cost >= leaf_cost && node.count <= MAX_LEAF_SIZE)
+	{
+		return;
+	}
+
+	//partition the primitive indices
+	auto begin = m_prim_indices.begin() + node.left_first;
+	auto end = begin + node.count;
+	auto mid = std::partition(begin, end, [&](uint32_t index)
+		{
+			return m_prim_bounds[index].center()[axis] < split_pos;
+		});
+	auto left_count = static_cast<uint32_t>(mid - begin);
+
+	//float precision at the bin border can put everything on one side, fall back to a median split
+	if (left_count == 0 || left_count == node.count)
+	{
+		left_count = node.count / 2;
+		std::nth_element(begin, begin + left_count, end, [&](uint32_t l, uint32_t r)
+			{
+				return m_prim_bounds[l].center()[axis] < m_prim_bounds[r].center()[axis];
+			});
+	}
+
+	Node left, right;
+	left.left_first = node.left_first;
+	left.count = left_count;
+	right.left_first = node.left_first + left_count;
+	right.count = node.count - left_count;
+
+	const auto left_index = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.push_back(left);
+	m_nodes.push_back(right);
+	m_parents.insert(m_parents.end(), 2, node_index);
+	m_depths.insert(m_depths.end(), 2, depth + 1);
+	m_build_area.insert(m_build_area.end(), 2, 0.0f);
+	update_bounds(left_index);
+	update_bounds(left_index + 1);
+
+	//turn the node into an inner node
+	m_nodes[node_index].left_first = left_index;
+	m_nodes[node_index].count = 0;
+
+	subdivide(left_index);
+	subdivide(left_index + 1);
+}
+
+void BVH::update(uint32_t prim_index, const AABB& bounds)
+{
+	if (prim_index >= m_prim_bounds.size())
+	{
+		return;
+	}
+	m_prim_bounds[prim_index] = bounds;
+
+	//refit the leaf
+	uint32_t node_index = m_prim_leaf[prim_index];
+	{
+		Node& leaf = m_nodes[node_index];
+		leaf.bounds = AABB();
+		for (uint32_t i = 0; i < leaf.count; ++i)
+		{
+			leaf.bounds.grow(m_prim_bounds[m_prim_indices[leaf.left_first + i]]);
+		}
+	}
+
+	//refit all ancestors and remember the highest one that degenerated
+	uint32_t rebuild_index = INVALID_INDEX;
+	while (true)
+	{
+		if (m_nodes[node_index].bounds.half_perimeter() > REBUILD_THRESHOLD * m_build_area[node_index])
+		{
+			rebuild_index = node_index;
+		}
+
+		const uint32_t parent = m_parents[node_index];
+		if (parent == INVALID_INDEX)
+		{
+			break;
+		}
+		Node& node = m_nodes[parent];
+		node.bounds = m_nodes[node.left_first].bounds;
+		node.bounds.grow(m_nodes[node.left_first + 1].bounds);
+		node_index = parent;
+	}
+
+	if (rebuild_index != INVALID_INDEX)
+	{
+		rebuild_subtree(rebuild_index);
+	}
+}
+
+uint32_t BVH::count_nodes(uint32_t node_index) const
+{
+	const Node& node = m_nodes[node_index];
+	if (node.is_leaf())
+	{
+		return 1;
+	}
+	return 1 + count_nodes(node.left_first) + count_nodes(node.left_first + 1);
+}
+
+void BVH::rebuild_subtree(uint32_t node_index)
+{
+	//the primitives of a subtree are a contiguous range, find it from the outermost leaves
+	uint32_t first = node_index;
+	while (!m_nodes[first].is_leaf())
+	{
+		first = m_nodes[first].left_first;
+	}
+	uint32_t last = node_index;
+	while (!m_nodes[last].is_leaf())
+	{
+		last = m_nodes[last].left_first + 1;
+	}
+	const uint32_t prim_begin = m_nodes[first].left_first;
+	const uint32_t prim_end = m_nodes[last].left_first + m_nodes[last].count;
+
+	//the old children stay in the node array until the next full rebuild
+	m_unused_nodes += count_nodes(node_index) - 1;
+	if (m_unused_nodes > m_nodes.size() / 2)
+	{
+		build(std::vector<AABB>(m_prim_bounds));
+		return;
+	}
+
+	//the root of the subtree keeps its slot, new children are appended
+	Node& node = m_nodes[node_index];
+	node.left_first = prim_begin;
+	node.count = prim_end - prim_begin;
+	update_bounds(node_index);
+	subdivide(node_index);
+}
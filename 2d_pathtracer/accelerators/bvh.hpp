@@ -0,0 +1,329 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "../geometry/aabb.hpp"
+#include "../geometry/ray.hpp"
+#include "../geometry/ray_packet.hpp"
+#include "../geometry/intersections.hpp"
+
+/// \brief Bounding volume hierarchy over primitive bounds, built with the surface area heuristic
+///
+/// The BVH only knows primitive indices and their bounds. The actual primitive
+/// intersection is done by a callback, so the same structure works for every primitive storage.
+class BVH
+{
+public:
+	struct Node
+	{
+		AABB bounds;
+		//index of the left child (right child is left + 1) or of the first primitive for leaves
+		uint32_t left_first = 0;
+		//number of primitives, 0 for inner nodes
+		uint32_t count = 0;
+
+		bool is_leaf() const { return count > 0; }
+	};
+
+	BVH() = default;
+
+	/// \brief build the hierarchy
+	/// \param [in] prim_bounds bounds of all primitives, the position in the vector is the primitive index
+	void build(const std::vector<AABB>& prim_bounds);
+
+	/// \brief update the hierarchy after a single primitive changed its bounds
+	///
+	/// Only the ancestors of the primitive's leaf are refitted. If the refitted bounds of an
+	/// ancestor grew too much compared to its bounds at build time, the subtree of the highest
+	/// such ancestor is rebuilt.
+	/// \param [in] prim_index index of the changed primitive
+	/// \param [in] bounds new bounds of the primitive
+	void update(uint32_t prim_index, const AABB& bounds);
+
+	void clear();
+	bool empty() const { return m_nodes.empty(); }
+
+	const std::vector<Node>& get_nodes() const { return m_nodes; }
+
+	/// Find the closest hit.
+	/// \param [in] ray The ray.
+	/// \param [in,out] isect closest intersection, t_max is used to cull nodes
+	/// \param [in] intersect bool(const uint32_t* prim_indices, uint32_t count, const Ray&, Intersection&),
+	///		called once with all primitives of a visited leaf so they can be tested in a batch
+	template <typename IntersectFn>
+	bool first_intersection(const Ray& ray, Intersection& isect, IntersectFn&& intersect) const;
+
+	/// Find the closest hits of a packet of rays with a common origin.
+	/// The packet traverses the hierarchy together, nodes outside the wedge of the packet
+	/// or behind the hits of all rays are skipped once for all rays.
+	/// \param [in] packet the rays
+	/// \param [in,out] isects closest intersection of each ray
+	/// \param [in,out] hits set to true for the rays that found a hit
+	/// \param [in] intersect same callback as for first_intersection
+	template <typename IntersectFn>
+	void first_intersection_packet(const RayPacket& packet, Intersection* isects, bool* hits, IntersectFn&& intersect) const;
+
+	/// Test if any primitive is hit closer than max_dist (stops at the first hit)
+	/// \param [in] ray The ray.
+	/// \param [in] max_dist maximum distance between origin and the hit
+	/// \param [in] occluded bool(const uint32_t* prim_indices, uint32_t count, const Ray&, float max_dist)
+	template <typename OccludedFn>
+	bool any_intersection(const Ray& ray, float max_dist, OccludedFn&& occluded) const;
+
+	/// Calls fn(uint32_t prim_index) for every primitive whose bounds overlap box
+	template <typename Fn>
+	void for_each_overlap(const AABB& box, Fn&& fn) const;
+
+private:
+	void subdivide(uint32_t node_index);
+	//returns the SAH cost of the best split, axis and split position are written to the out parameters
+	float find_best_split(const Node& node, int& axis, float& split_pos) const;
+	//computes the bounds of a leaf from its primitives
+	void update_bounds(uint32_t node_index);
+	void rebuild_subtree(uint32_t node_index);
+	uint32_t count_nodes(uint32_t node_index) const;
+
+	std::vector<Node> m_nodes;
+	//primitive indices, leaves reference a range in here
+	std::vector<uint32_t> m_prim_indices;
+
+	//data for incremental updates, kept out of Node to keep the traversal data small
+	std::vector<AABB> m_prim_bounds;
+	std::vector<uint32_t> m_parents;
+	std::vector<uint32_t> m_depths;
+	//half perimeter of each node when it was built
+	std::vector<float> m_build_area;
+	//leaf of every primitive
+	std::vector<uint32_t> m_prim_leaf;
+	//nodes that are no longer referenced after a local rebuild
+	uint32_t m_unused_nodes = 0;
+
+	static constexpr int STACK_SIZE = 64;
+};
+
+
+template <typename IntersectFn>
+bool BVH::first_intersection(const Ray& ray, Intersection& isect, IntersectFn&& intersect) const
+{
+	if (m_nodes.empty())
+	{
+		return false;
+	}
+
+	const glm::vec2 inv_dir = glm::vec2(1.0f) / ray.direction;
+	bool hit_any = false;
+
+	//nodes are stored together with their entry distance to cull them if a closer hit was found in between
+	struct StackEntry
+	{
+		uint32_t node;
+		float t_near;
+	};
+	StackEntry stack[STACK_SIZE];
+	int stack_ptr = 0;
+	float t_root;
+	if (!m_nodes[0].bounds.intersect(ray, inv_dir, isect.t_max, t_root))
+	{
+		return false;
+	}
+	stack[stack_ptr++] = { 0, t_root };
+
+	while (stack_ptr > 0)
+	{
+		const StackEntry entry = stack[--stack_ptr];
+		if (entry.t_near >= isect.t_max)
+		{
+			continue;
+		}
+		const Node& node = m_nodes[entry.node];
+
+		if (node.is_leaf())
+		{
+			if (intersect(&m_prim_indices[node.left_first], node.count, ray, isect))
+			{
+				hit_any = true;
+			}
+			continue;
+		}
+
+		//visit the closer child first, the other one is culled later if the hit is already closer
+		float t_left, t_right;
+		const bool hit_left = m_nodes[node.left_first].bounds.intersect(ray, inv_dir, isect.t_max, t_left);
+		const bool hit_right = m_nodes[node.left_first + 1].bounds.intersect(ray, inv_dir, isect.t_max, t_right);
+
+		if (hit_left && hit_right)
+		{
+			if (t_left <= t_right)
+			{
+				stack[stack_ptr++] = { node.left_first + 1, t_right };
+				stack[stack_ptr++] = { node.left_first, t_left };
+			}
+			else
+			{
+				stack[stack_ptr++] = { node.left_first, t_left };
+				stack[stack_ptr++] = { node.left_first + 1, t_right };
+			}
+		}
+		else if (hit_left)
+		{
+			stack[stack_ptr++] = { node.left_first, t_left };
+		}
+		else if (hit_right)
+		{
+			stack[stack_ptr++] = { node.left_first + 1, t_right };
+		}
+	}
+	return hit_any;
+}
+
+template <typename IntersectFn>
+void BVH::first_intersection_packet(const RayPacket& packet, Intersection* isects, bool* hits, IntersectFn&& intersect) const
+{
+	if (m_nodes.empty() || packet.count == 0)
+	{
+		return;
+	}
+
+	const RayWedge wedge(packet);
+	Ray rays[RayPacket::MAX_SIZE];
+	for (uint32_t k = 0; k < packet.count; ++k)
+	{
+		rays[k] = packet.ray(k);
+	}
+
+	//all rays start at the same point, so the distance to a node is the same for the whole packet
+	struct StackEntry
+	{
+		uint32_t node;
+		float distance;
+	};
+	StackEntry stack[STACK_SIZE];
+	int stack_ptr = 0;
+	stack[stack_ptr++] = { 0, m_nodes[0].bounds.distance(packet.origin) };
+
+	while (stack_ptr > 0)
+	{
+		const StackEntry entry = stack[--stack_ptr];
+		//a node further away than the hits of all rays can not contain a closer hit
+		float t_max = 0.0f;
+		for (uint32_t k = 0; k < packet.count; ++k)
+		{
+			t_max = glm::max(t_max, isects[k].t_max);
+		}
+		const Node& node = m_nodes[entry.node];
+		if (entry.distance >= t_max || wedge.excludes(node.bounds))
+		{
+			continue;
+		}
+
+		if (node.is_leaf())
+		{
+			for (uint32_t k = 0; k < packet.count; ++k)
+			{
+				if (entry.distance < isects[k].t_max &&
+					intersect(&m_prim_indices[node.left_first], node.count, rays[k], isects[k]))
+				{
+					hits[k] = true;
+				}
+			}
+			continue;
+		}
+
+		//visit the closer child first
+		const float d_left = m_nodes[node.left_first].bounds.distance(packet.origin);
+		const float d_right = m_nodes[node.left_first + 1].bounds.distance(packet.origin);
+		if (d_left <= d_right)
+		{
+			stack[stack_ptr++] = { node.left_first + 1, d_right };
+			stack[stack_ptr++] = { node.left_first, d_left };
+		}
+		else
+		{
+			stack[stack_ptr++] = { node.left_first, d_left };
+			stack[stack_ptr++] = { node.left_first + 1, d_right };
+		}
+	}
+}
+
+template <typename OccludedFn>
+bool BVH::any_intersection(const Ray& ray, float max_dist, OccludedFn&& occluded) const
+{
+	if (m_nodes.empty())
+	{
+		return false;
+	}
+
+	const glm::vec2 inv_dir = glm::vec2(1.0f) / ray.direction;
+
+	uint32_t stack[STACK_SIZE];
+	int stack_ptr = 0;
+	stack[stack_ptr++] = 0;
+
+	while (stack_ptr > 0)
+	{
+		const Node& node = m_nodes[stack[--stack_ptr]];
+		float t_near;
+		if (!node.bounds.intersect(ray, inv_dir, max_dist, t_near))
+		{
+			continue;
+		}
+
+		if (node.is_leaf())
+		{
+			//early out, any hit is enough for shadow rays
+			if (occluded(&m_prim_indices[node.left_first], node.count, ray, max_dist))
+			{
+				return true;
+			}
+			continue;
+		}
+
+		stack[stack_ptr++] = node.left_first + 1;
+		stack[stack_ptr++] = node.left_first;
+	}
+	return false;
+}
+
+template <typename Fn>
+void BVH::for_each_overlap(const AABB& box, Fn&& fn) const
+{
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	const auto overlaps = [&box](const AABB& other)
+	{
+		return box.min.x <= other.max.x && other.min.x <= box.max.x && box.min.y <= other.max.y && other.min.y <= box.max.y;
+	};
+
+	uint32_t stack[STACK_SIZE];
+	int stack_ptr = 0;
+	stack[stack_ptr++] = 0;
+	while (stack_ptr > 0)
+	{
+		const Node& node = m_nodes[stack[--stack_ptr]];
+		if (!overlaps(node.bounds))
+		{
+			continue;
+		}
+
+		if (node.is_leaf())
+		{
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				const uint32_t prim = m_prim_indices[node.left_first + i];
+				if (overlaps(m_prim_bounds[prim]))
+				{
+					fn(prim);
+				}
+			}
+			continue;
+		}
+
+		stack[stack_ptr++] = node.left_first + 1;
+		stack[stack_ptr++] = node.left_first;
+	}
+}
@@ -0,0 +1,130 @@
+#include "uniform_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	//average number of cells per primitive
+	constexpr float CELLS_PER_PRIMITIVE = 2.0f;
+	constexpr int MAX_RESOLUTION = 2048;
+
+	/// mailbox stamps of one nesting level of the queries of a thread
+	struct MailboxLevel
+	{
+		std::vector<uint32_t> stamps;
+		uint32_t stamp = 0;
+	};
+
+	struct MailboxState
+	{
+		std::vector<MailboxLevel> levels;
+		//number of queries of this thread that are running
+		uint32_t depth = 0;
+	};
+
+	thread_local MailboxState mailbox_state;
+}
+
+UniformGrid::Mailbox::Mailbox(uint32_t _num_prims)
+{
+	MailboxState& state = mailbox_state;
+	if (state.levels.size() <= state.depth)
+	{
+		//the stamp arrays keep their memory when the levels move
+		state.levels.resize(state.depth + 1);
+	}
+	MailboxLevel& level = state.levels[state.depth++];
+	if (level.stamps.size() < _num_prims)
+	{
+		level.stamps.resize(_num_prims, 0);
+	}
+	//older queries have smaller stamps, the array only needs to be cleared when the stamp wraps around
+	if (++level.stamp == 0)
+	{
+		std::fill(level.stamps.begin(), level.stamps.end(), 0);
+		level.stamp = 1;
+	}
+	m_stamps = level.stamps.data();
+	m_stamp = level.stamp;
+}
+
+UniformGrid::Mailbox::~Mailbox()
+{
+	--mailbox_state.depth;
+}
+
+void UniformGrid::build(const std::vector<AABB>& prim_bounds, const glm::vec2& scene_size)
+{
+	clear();
+	if (prim_bounds.empty())
+	{
+		return;
+	}
+	m_num_prims = static_cast<uint32_t>(prim_bounds.size());
+
+	//the grid covers the scene and all primitives that stick out of it
+	m_bounds = AABB(glm::vec2(0.0f), scene_size);
+	for (const auto& box : prim_bounds)
+	{
+		m_bounds.grow(box);
+	}
+
+	//choose a square cell size so that the scene has about CELLS_PER_PRIMITIVE cells per primitive
+	const float scene_area = glm::max(scene_size.x * scene_size.y, 1e-6f);
+	const float cell_size = std::sqrt(scene_area / (CELLS_PER_PRIMITIVE * static_cast<float>(prim_bounds.size())));
+	const glm::vec2 extent = glm::max(m_bounds.extent(), glm::vec2(1e-6f));
+	m_resolution = glm::clamp(glm::ivec2(glm::ceil(extent / cell_size)), glm::ivec2(1), glm::ivec2(MAX_RESOLUTION));
+	m_cell_size = extent / glm::vec2(m_resolution);
+
+	const auto cell_range = [&](const AABB& box, glm::ivec2& lo, glm::ivec2& hi)
+	{
+		lo = glm::clamp(glm::ivec2(glm::floor((box.min - m_bounds.min) / m_cell_size)), glm::ivec2(0), m_resolution - 1);
+		hi = glm::clamp(glm::ivec2(glm::floor((box.max - m_bounds.min) / m_cell_size)), glm::ivec2(0), m_resolution - 1);
+	};
+
+	//count the primitives per cell, then fill the compact index list
+	const uint32_t num_cells = m_resolution.x * m_resolution.y;
+	m_cell_start.assign(num_cells + 1, 0);
+	for (const auto& box : prim_bounds)
+	{
+		glm::ivec2 lo, hi;
+		cell_range(box, lo, hi);
+		for (int y = lo.y; y <= hi.y; ++y)
+		{
+			for (int x = lo.x; x <= hi.x; ++x)
+			{
+				m_cell_start[y * m_resolution.x + x + 1]++;
+			}
+		}
+	}
+	for (uint32_t i = 0; i < num_cells; ++i)
+	{
+		m_cell_start[i + 1] += m_cell_start[i];
+	}
+
+	m_cell_prims.resize(m_cell_start[num_cells]);
+	std::vector<uint32_t> fill(m_cell_start.begin(), m_cell_start.end() - 1);
+	for (uint32_t prim = 0; prim < prim_bounds.size(); ++prim)
+	{
+		glm::ivec2 lo, hi;
+		cell_range(prim_bounds[prim], lo, hi);
+		for (int y = lo.y; y <= hi.y; ++y)
+		{
+			for (int x = lo.x; x <= hi.x; ++x)
+			{
+				m_cell_prims[fill[y * m_resolution.x + x]++] = prim;
+			}
+		}
+	}
+}
+
+void UniformGrid::clear()
+{
+	m_bounds = AABB();
+	m_num_prims = 0;
+	m_resolution = glm::ivec2(0);
+	m_cell_size = glm::vec2(0.0f);
+	m_cell_start.clear();
+	m_cell_prims.clear();
+}
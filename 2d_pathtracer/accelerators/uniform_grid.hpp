@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "../geometry/aabb.hpp"
+#include "../geometry/ray.hpp"
+#include "../geometry/intersections.hpp"
+
+/// \brief Uniform grid over primitive bounds, traversed with a 2D DDA (Amanatides & Woo)
+///
+/// Works best for dense scenes with evenly distributed primitives. Like the BVH it only
+/// stores primitive indices, the intersection itself is done by a callback.
+class UniformGrid
+{
+public:
+	UniformGrid() = default;
+
+	/// \brief build the grid
+	/// \param [in] prim_bounds bounds of all primitives, the position in the vector is the primitive index
+	/// \param [in] scene_size size of the scene, used together with the number of primitives to choose the resolution
+	void build(const std::vector<AABB>& prim_bounds, const glm::vec2& scene_size);
+
+	void clear();
+	bool empty() const { return m_cell_start.empty(); }
+
+	glm::ivec2 get_resolution() const { return m_resolution; }
+
+	/// Find the closest hit.
+	/// \param [in] ray The ray.
+	/// \param [in,out] isect closest intersection
+	/// \param [in] intersect bool(const uint32_t* prim_indices, uint32_t count, const Ray&, Intersection&),
+	///		called with the primitives of a cell that were not tested before
+	template <typename IntersectFn>
+	bool first_intersection(const Ray& ray, Intersection& isect, IntersectFn&& intersect) const;
+
+	/// Test if any primitive is hit closer than max_dist (stops at the first hit)
+	/// \param [in] ray The ray.
+	/// \param [in] max_dist maximum distance between origin and the hit
+	/// \param [in] occluded bool(const uint32_t* prim_indices, uint32_t count, const Ray&, float max_dist)
+	template <typename OccludedFn>
+	bool any_intersection(const Ray& ray, float max_dist, OccludedFn&& occluded) const;
+
+private:
+	/// Walks through all cells hit by the ray (front to back) until visit_cell returns false
+	/// visit_cell: bool(uint32_t first, uint32_t count, float t_cell_exit)
+	template <typename CellFn>
+	void traverse(const Ray& ray, float t_max, CellFn&& visit_cell) const;
+
+	/// Remembers which primitives a query already tested, so a primitive that spans many cells
+	/// is only tested once per ray. Every thread keeps the stamp of the query that tested a primitive last,
+	/// indexed by the primitive, and every query gets a new stamp. Queries that are nested in the callbacks
+	/// of another query use their own stamps.
+	class Mailbox
+	{
+	public:
+		explicit Mailbox(uint32_t num_prims);
+		~Mailbox();
+
+		Mailbox(const Mailbox&) = delete;
+		Mailbox& operator=(const Mailbox&) = delete;
+
+		// returns true if the primitive was already tested and marks it as tested otherwise
+		bool check_and_set(uint32_t prim_index)
+		{
+			if (m_stamps[prim_index] == m_stamp)
+			{
+				return true;
+			}
+			m_stamps[prim_index] = m_stamp;
+			return false;
+		}
+
+	private:
+		uint32_t* m_stamps;
+		uint32_t m_stamp;
+	};
+
+	//maximum number of primitives passed to the callbacks at once
+	static constexpr uint32_t BATCH_SIZE = 32;
+
+	AABB m_bounds;
+	uint32_t m_num_prims = 0;
+	glm::ivec2 m_resolution = glm::ivec2(0);
+	glm::vec2 m_cell_size = glm::vec2(0.0f);
+	//cell i references m_cell_prims[m_cell_start[i], m_cell_start[i + 1])
+	std::vector<uint32_t> m_cell_start;
+	std::vector<uint32_t> m_cell_prims;
+};
+
+
+template <typename CellFn>
+void UniformGrid::traverse(const Ray& ray, float t_max, CellFn&& visit_cell) const
+{
+	if (m_cell_start.empty())
+	{
+		return;
+	}
+
+	const glm::vec2 inv_dir = glm::vec2(1.0f) / ray.direction;
+	float t_enter;
+	if (!m_bounds.intersect(ray, inv_dir, t_max, t_enter))
+	{
+		return;
+	}
+	t_enter = glm::max(t_enter, 0.0f);
+
+	//cell where the ray enters the grid
+	const glm::vec2 entry = ray.origin + ray.direction * t_enter;
+	glm::ivec2 cell = glm::clamp(glm::ivec2(glm::floor((entry - m_bounds.min) / m_cell_size)), glm::ivec2(0),
+	                             m_resolution - 1);
+
+	glm::ivec2 step;
+	glm::vec2 t_next;
+	glm::vec2 t_delta;
+	for (int a = 0; a < 2; ++a)
+	{
+		if (ray.direction[a] > 0.0f)
+		{
+			step[a] = 1;
+			t_next[a] = (m_bounds.min[a] + (cell[a] + 1) * m_cell_size[a] - ray.origin[a]) * inv_dir[a];
+			t_delta[a] = m_cell_size[a] * inv_dir[a];
+		}
+		else if (ray.direction[a] < 0.0f)
+		{
+			step[a] = -1;
+			t_next[a] = (m_bounds.min[a] + cell[a] * m_cell_size[a] - ray.origin[a]) * inv_dir[a];
+			t_delta[a] = -m_cell_size[a] * inv_dir[a];
+		}
+		else
+		{
+			step[a] = 0;
+			t_next[a] = std::numeric_limits<float>::max();
+			t_delta[a] = std::numeric_limits<float>::max();
+		}
+	}
+
+	while (true)
+	{
+		const uint32_t index = cell.y * m_resolution.x + cell.x;
+		const float t_exit = glm::min(t_next.x, t_next.y);
+		if (!visit_cell(m_cell_start[index], m_cell_start[index + 1] - m_cell_start[index], t_exit))
+		{
+			return;
+		}
+		if (t_exit >= t_max)
+		{
+			return;
+		}
+
+		//step into the next cell along the axis with the closest cell border
+		const int axis = t_next.x < t_next.y ? 0 : 1;
+		cell[axis] += step[axis];
+		if (cell[axis] < 0 || cell[axis] >= m_resolution[axis])
+		{
+			return;
+		}
+		t_next[axis] += t_delta[axis];
+	}
+}
+
+template <typename IntersectFn>
+bool UniformGrid::first_intersection(const Ray& ray, Intersection& isect, IntersectFn&& intersect) const
+{
+	bool hit_any = false;
+	Mailbox mailbox(m_num_prims);
+	traverse(ray, isect.t_max, [&](uint32_t first, uint32_t count, float t_exit)
+		{
+			//primitives that are new to the mailbox are passed on in batches
+			uint32_t batch[BATCH_SIZE];
+			uint32_t batch_count = 0;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const uint32_t prim = m_cell_prims[first + i];
+				if (mailbox.check_and_set(prim))
+				{
+					continue;
+				}
+				batch[batch_count++] = prim;
+				if (batch_count == BATCH_SIZE)
+				{
+					hit_any |= intersect(batch, batch_count, ray, isect);
+					batch_count = 0;
+				}
+			}
+			if (batch_count > 0)
+			{
+				hit_any |= intersect(batch, batch_count, ray, isect);
+			}
+			//a hit inside this cell can not be beaten by primitives in later cells
+			return isect.t_max > t_exit;
+		});
+	return hit_any;
+}
+
+template <typename OccludedFn>
+bool UniformGrid::any_intersection(const Ray& ray, float max_dist, OccludedFn&& occluded) const
+{
+	bool hit_any = false;
+	Mailbox mailbox(m_num_prims);
+	traverse(ray, max_dist, [&](uint32_t first, uint32_t count, float)
+		{
+			uint32_t batch[BATCH_SIZE];
+			uint32_t batch_count = 0;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const uint32_t prim = m_cell_prims[first + i];
+				if (mailbox.check_and_set(prim))
+				{
+					continue;
+				}
+				batch[batch_count++] = prim;
+				if (batch_count == BATCH_SIZE && occluded(batch, batch_count, ray, max_dist))
+				{
+					hit_any = true;
+					return false;
+				}
+				batch_count %= BATCH_SIZE;
+			}
+			if (batch_count > 0 && occluded(batch, batch_count, ray, max_dist))
+			{
+				hit_any = true;
+				return false;
+			}
+			return true;
+		});
+	return hit_any;
+}
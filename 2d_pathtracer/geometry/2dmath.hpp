@@ -17,3 +17,27 @@ inline glm::vec2 rotate(const glm::vec2& vec, float angle)
 		vec.x * std::cos(angle) - vec.y * std::sin(angle),
 		vec.x * std::sin(angle) + vec.y * std::cos(angle));
 }
+
+/// crossing of the segments a0-a1 and b0-b1
+/// \param [out] crossing the point where they cross
+/// \return false if they do not cross (parallel segments never cross)
+inline bool segment_crossing(glm::vec2 a0, glm::vec2 a1, glm::vec2 b0, glm::vec2 b1, glm::vec2& crossing)
+{
+	const glm::vec2 da = a1 - a0;
+	const glm::vec2 db = b1 - b0;
+	const float denom = cross2d(da, db);
+	if (denom == 0.0f)
+	{
+		return false;
+	}
+	//positions of the crossing along both segments in [0,1]
+	const glm::vec2 ab = b0 - a0;
+	const float u = cross2d(ab, db) / denom;
+	const float v = cross2d(ab, da) / denom;
+	if (u < 0.0f || u > 1.0f || v < 0.0f || v > 1.0f)
+	{
+		return false;
+	}
+	crossing = a0 + u * da;
+	return true;
+}
@@ -1,11 +1,161 @@
 #include "2dtypes.hpp"
 
+#include <cmath>
+#include <limits>
 #include <glm/glm.hpp>
 
 #include "2dmath.hpp"
 #include "ray.hpp"
 #include "intersections.hpp"
 
+namespace
+{
+	//points where the segment a-b crosses the circle
+	void segment_circle_crossings(glm::vec2 a, glm::vec2 b, glm::vec2 center, float radius,
+	                              std::vector<glm::vec2>& crossings)
+	{
+		const glm::vec2 d = b - a;
+		const glm::vec2 f = a - center;
+		const float A = glm::dot(d, d);
+		const float B = glm::dot(f, d);
+		const float C = glm::dot(f, f) - radius * radius;
+		const float det_sq = B * B - A * C;
+		if (A <= 0.0f || det_sq < 0.0f)
+		{
+			return;
+		}
+		const float det = std::sqrt(det_sq);
+		for (float u : { (-B - det) / A, (-B + det) / A })
+		{
+			if (u >= 0.0f && u <= 1.0f)
+			{
+				crossings.emplace_back(a + u * d);
+			}
+		}
+	}
+
+	//true if the axes are orthogonal and have the same length, radius is the length
+	bool is_circle(const glm::mat2& axes, float& radius)
+	{
+		const float len0 = glm::length(axes[0]);
+		const float len1 = glm::length(axes[1]);
+		radius = len0;
+		return glm::abs(glm::dot(axes[0], axes[1])) <= 1e-5f * len0 * len1 && glm::abs(len0 - len1) <= 1e-5f * len0;
+	}
+
+	//points where the segment a-b crosses the ellipse, the segment is mapped to the unit circle of the ellipse
+	void segment_ellipse_crossings(glm::vec2 a, glm::vec2 b, const Ellipse& ellipse, std::vector<glm::vec2>& crossings)
+	{
+		float radius;
+		if (is_circle(ellipse.axes, radius))
+		{
+			segment_circle_crossings(a, b, ellipse.center, radius, crossings);
+			return;
+		}
+
+		const glm::mat2 to_unit = glm::inverse(ellipse.axes);
+		std::vector<glm::vec2> unit_crossings;
+		segment_circle_crossings(to_unit * (a - ellipse.center), to_unit * (b - ellipse.center), glm::vec2(0.0f), 1.0f,
+		                         unit_crossings);
+		for (const auto& p : unit_crossings)
+		{
+			crossings.push_back(ellipse.center + ellipse.axes * p);
+		}
+	}
+
+	//points where two circles cross
+	void circle_crossings(glm::vec2 center0, float radius0, glm::vec2 center1, float radius1,
+	                      std::vector<glm::vec2>& crossings)
+	{
+		const glm::vec2 d = center1 - center0;
+		const float dist = glm::length(d);
+		//separate, contained or concentric circles do not cross
+		if (dist <= 0.0f || dist > radius0 + radius1 || dist < glm::abs(radius0 - radius1))
+		{
+			return;
+		}
+
+		//distance from center0 to the chord through both crossings
+		const float chord = (dist * dist + radius0 * radius0 - radius1 * radius1) / (2.0f * dist);
+		const float half_width = std::sqrt(glm::max(radius0 * radius0 - chord * chord, 0.0f));
+		const glm::vec2 dir = d / dist;
+		const glm::vec2 base = center0 + dir * chord;
+		const glm::vec2 normal(-dir.y, dir.x);
+		crossings.push_back(base + normal * half_width);
+		crossings.push_back(base - normal * half_width);
+	}
+
+	//a0 + a1 cos t + b1 sin t + a2 cos 2t + b2 sin 2t
+	struct TrigPolynomial
+	{
+		double a0, a1, b1, a2, b2;
+
+		double operator()(double t) const
+		{
+			return a0 + a1 * std::cos(t) + b1 * std::sin(t) + a2 * std::cos(2.0 * t) + b2 * std::sin(2.0 * t);
+		}
+	};
+
+	//adds the parameters in [t0, t1] where f changes its sign. |f'| <= slope, so an interval can only contain
+	//a root if |f| at its middle is at most slope * half its width. touching without a sign change is no crossing
+	void find_sign_changes(const TrigPolynomial& f, double slope, double t0, double f0, double t1, double f1, int depth,
+	                       std::vector<double>& roots)
+	{
+		const double mid = 0.5 * (t0 + t1);
+		const double f_mid = f(mid);
+		if (std::abs(f_mid) > slope * 0.5 * (t1 - t0))
+		{
+			return;
+		}
+		if (depth == 0)
+		{
+			if ((f0 < 0.0) != (f1 < 0.0))
+			{
+				roots.push_back(mid);
+			}
+			return;
+		}
+		find_sign_changes(f, slope, t0, f0, mid, f_mid, depth - 1, roots);
+		find_sign_changes(f, slope, mid, f_mid, t1, f1, depth - 1, roots);
+	}
+
+	//points where two ellipses cross. the second one is mapped to the unit circle of the first one,
+	//where |p(t)|^2 - 1 of its points p(t) is a trigonometric polynomial of degree 2 (at most 4 roots)
+	void ellipse_crossings(const Ellipse& ellipse0, const Ellipse& ellipse1, std::vector<glm::vec2>& crossings)
+	{
+		float radius0, radius1;
+		if (is_circle(ellipse0.axes, radius0) && is_circle(ellipse1.axes, radius1))
+		{
+			circle_crossings(ellipse0.center, radius0, ellipse1.center, radius1, crossings);
+			return;
+		}
+
+		const glm::dmat2 to_unit = glm::inverse(glm::dmat2(ellipse0.axes));
+		const glm::dvec2 c = to_unit * glm::dvec2(ellipse1.center - ellipse0.center);
+		const glm::dmat2 axes = to_unit * glm::dmat2(ellipse1.axes);
+		//|c + axes u|^2 - 1 = |c|^2 - 1 + 2 (axes^T c) . u + u^T (axes^T axes) u with u = (cos t, sin t)
+		const glm::dvec2 linear = 2.0 * (glm::transpose(axes) * c);
+		const glm::dmat2 quadratic = glm::transpose(axes) * axes;
+		const TrigPolynomial f = {
+			glm::dot(c, c) - 1.0 + 0.5 * (quadratic[0][0] + quadratic[1][1]),
+			linear.x, linear.y,
+			0.5 * (quadratic[0][0] - quadratic[1][1]), quadratic[0][1]
+		};
+		const double slope = std::hypot(f.a1, f.b1) + 2.0 * std::hypot(f.a2, f.b2);
+
+		//2 pi / 2^24, far below float precision of the crossings
+		constexpr int MAX_DEPTH = 24;
+		constexpr double TWO_PI = 6.283185307179586;
+		std::vector<double> roots;
+		find_sign_changes(f, slope, 0.0, f(0.0), TWO_PI, f(TWO_PI), MAX_DEPTH, roots);
+		for (double t : roots)
+		{
+			const glm::vec2 u(static_cast<float>(std::cos(t)), static_cast<float>(std::sin(t)));
+			crossings.push_back(ellipse1.center + ellipse1.axes * u);
+		}
+	}
+}
+
 bool Segment::first_intersection(const Ray& ray, Intersection& isect) const
 {
 	glm::vec2 sT = b - a;
@@ -18,7 +168,7 @@ bool Segment::first_intersection(const Ray& ray, Intersection& isect) const
 
 	isect.t_max = t;
 	isect.normal = normalize(sN);
-	isect.material = this->m_material;
+	isect.material_id = this->m_material_id;
 	return true;
 }
 
@@ -34,6 +184,28 @@ std::vector<glm::vec2> Segment::get_draw_vertices() const
 	return std::vector<glm::vec2>({ a,b });
 }
 
+AABB Segment::get_bounds() const
+{
+	return AABB(glm::min(a, b), glm::max(a, b));
+}
+
+std::vector<glm::vec2> Segment::get_silhouette_points(glm::vec2 viewpoint) const
+{
+	return std::vector<glm::vec2>({ a,b });
+}
+
+std::vector<glm::vec2> Segment::get_ellipse_crossings(const Ellipse& ellipse) const
+{
+	std::vector<glm::vec2> crossings;
+	segment_ellipse_crossings(a, b, ellipse, crossings);
+	return crossings;
+}
+
+std::vector<Edge> Segment::get_outline_edges() const
+{
+	return std::vector<Edge>({ Edge{ a, b } });
+}
+
 bool Segment::is_point_inside(glm::vec2 point) const
 {
 	auto ab = b - a;
@@ -79,16 +251,20 @@ bool BBox::first_intersection(const Ray& ray, Intersection& isect) const
 	float tmax = glm::min(isect.t_max, glm::min(maxX, maxY));
 
 	if (tmax >= tmin) {
-		auto temp = (tmin == isect.t_min) ? tmax : tmin;
+		const bool inside = tmin == isect.t_min;
+		auto temp = inside ? tmax : tmin;
 		if (temp >= isect.t_max)
 		{
 			return false;
 		}
 
-		isect.t_max = (tmin == isect.t_min) ? tmax : tmin;
-		isect.normal = isect.t_max == tx1 ? glm::vec2(-1.0, 0.0) : isect.t_max == tx2 ? glm::vec2(1.0, 0.0) :
-			isect.t_max == ty1 ? glm::vec2(0.0, -1.0) : glm::vec2(0.0, 1.0);
-		isect.material = this->m_material;
+		isect.t_max = temp;
+		// the normal belongs to the slab that limits the interval (the later entry or the earlier exit),
+		// it points against the ray on entry and along the ray on exit
+		const bool x_slab = inside ? maxX <= maxY : minX >= minY;
+		const glm::vec2 side = (inside ? 1.0f : -1.0f) * glm::sign(ray.direction);
+		isect.normal = x_slab ? glm::vec2(side.x, 0.0f) : glm::vec2(0.0f, side.y);
+		isect.material_id = this->m_material_id;
 
 		return true;
 	}
@@ -118,6 +294,38 @@ std::vector<glm::vec2> BBox::get_draw_vertices() const
 	return vertices;
 }
 
+AABB BBox::get_bounds() const
+{
+	return AABB(center - size, center + size);
+}
+
+std::vector<glm::vec2> BBox::get_silhouette_points(glm::vec2 viewpoint) const
+{
+	//the outline consists of 4 segments, seen from inside or outside only the corners are silhouettes
+	return get_draw_vertices();
+}
+
+std::vector<glm::vec2> BBox::get_ellipse_crossings(const Ellipse& ellipse) const
+{
+	std::vector<glm::vec2> crossings;
+	for (const auto& edge : get_outline_edges())
+	{
+		segment_ellipse_crossings(edge.a, edge.b, ellipse, crossings);
+	}
+	return crossings;
+}
+
+std::vector<Edge> BBox::get_outline_edges() const
+{
+	const auto corners = get_draw_vertices();
+	std::vector<Edge> edges;
+	for (size_t i = 0; i < corners.size(); ++i)
+	{
+		edges.push_back(Edge{ corners[i], corners[(i + 1) % corners.size()] });
+	}
+	return edges;
+}
+
 bool BBox::is_point_inside(glm::vec2 point) const
 {
 	glm::vec2 A = center - size;
@@ -146,8 +354,9 @@ bool Sphere::first_intersection(const Ray& ray, Intersection& isect) const
 {
 	glm::vec2 p = ray.origin - center;
 	float B = glm::dot(p, ray.direction);
-	float C = glm::dot(p, p) - radius * radius;
-	float detSq = B * B - C;
+	//r^2 - squared distance between center and ray, more precise than B^2 - C for distant spheres
+	glm::vec2 closest = p - B * ray.direction;
+	float detSq = radius * radius - glm::dot(closest, closest);
 	if (detSq >= 0.0f) {
 		float det = sqrt(detSq);
 		float t = -B - det;
@@ -156,7 +365,7 @@ bool Sphere::first_intersection(const Ray& ray, Intersection& isect) const
 		if (t > isect.t_min && t < isect.t_max) {
 			isect.t_max = t;
 			isect.normal = glm::normalize(p + ray.direction * t);
-			isect.material = this->m_material;
+			isect.material_id = this->m_material_id;
 			return true;
 		}
 	}
@@ -184,6 +393,43 @@ std::vector<glm::vec2> Sphere::get_draw_vertices() const
 	return vertices;
 }
 
+AABB Sphere::get_bounds() const
+{
+	return AABB(center - glm::vec2(radius), center + glm::vec2(radius));
+}
+
+std::vector<glm::vec2> Sphere::get_silhouette_points(glm::vec2 viewpoint) const
+{
+	const glm::vec2 to_center = center - viewpoint;
+	const float dist = glm::length(to_center);
+	//from inside every ray leaves the circle exactly once
+	if (dist <= radius)
+	{
+		return {};
+	}
+
+	//tangent points
+	const float alpha = std::asin(radius / dist);
+	const float tangent_length = std::sqrt(dist * dist - radius * radius);
+	const glm::vec2 dir = to_center / dist;
+	return std::vector<glm::vec2>({
+		viewpoint + rotate(dir, alpha) * tangent_length,
+		viewpoint + rotate(dir, -alpha) * tangent_length
+	});
+}
+
+std::vector<glm::vec2> Sphere::get_ellipse_crossings(const Ellipse& ellipse) const
+{
+	std::vector<glm::vec2> crossings;
+	ellipse_crossings(Ellipse{ center, glm::mat2(radius) }, ellipse, crossings);
+	return crossings;
+}
+
+std::vector<Ellipse> Sphere::get_outline_ellipses() const
+{
+	return std::vector<Ellipse>({ Ellipse{ center, glm::mat2(radius) } });
+}
+
 bool Sphere::is_point_inside(glm::vec2 point) const
 {
 	float d = radius * radius - ((center.x - point.x) * (center.x - point.x) + (center.y - point.y) * (center.y - point.y));
@@ -22,8 +22,13 @@ struct Segment : public Primitive
 	bool first_intersection(const Ray& ray, Intersection& isect) const override;
 	bool any_interscetion(const Ray& ray, float max_dist) const override;
 	std::vector<glm::vec2> get_draw_vertices() const override;
+	AABB get_bounds() const override;
+	std::vector<glm::vec2> get_silhouette_points(glm::vec2 viewpoint) const override;
+	std::vector<glm::vec2> get_ellipse_crossings(const Ellipse& ellipse) const override;
+	std::vector<Edge> get_outline_edges() const override;
 	bool is_point_inside(glm::vec2) const override;
 	void move(float dx, float dy) override;
+	std::shared_ptr<Primitive> clone() const override { return std::make_shared<Segment>(*this); }
 };
 
 
@@ -45,8 +50,13 @@ struct Sphere : Primitive
 	bool first_intersection(const Ray& ray, Intersection& isect) const override;
 	bool any_interscetion(const Ray& ray, float max_dist) const override;
 	std::vector<glm::vec2> get_draw_vertices() const override;
+	AABB get_bounds() const override;
+	std::vector<glm::vec2> get_silhouette_points(glm::vec2 viewpoint) const override;
+	std::vector<glm::vec2> get_ellipse_crossings(const Ellipse& ellipse) const override;
+	std::vector<Ellipse> get_outline_ellipses() const override;
 	bool is_point_inside(glm::vec2) const override;
 	void move(float dx, float dy) override;
+	std::shared_ptr<Primitive> clone() const override { return std::make_shared<Sphere>(*this); }
 };
 
 struct BBox : Primitive
@@ -67,6 +77,11 @@ struct BBox : Primitive
 	bool first_intersection(const Ray& ray, Intersection& isect) const override;
 	bool any_interscetion(const Ray& ray, float max_dist) const override;
 	std::vector<glm::vec2> get_draw_vertices() const override;
+	AABB get_bounds() const override;
+	std::vector<glm::vec2> get_silhouette_points(glm::vec2 viewpoint) const override;
+	std::vector<glm::vec2> get_ellipse_crossings(const Ellipse& ellipse) const override;
+	std::vector<Edge> get_outline_edges() const override;
 	bool is_point_inside(glm::vec2) const override;
 	void move(float dx, float dy) override;
+	std::shared_ptr<Primitive> clone() const override { return std::make_shared<BBox>(*this); }
 };
\ No newline at end of file
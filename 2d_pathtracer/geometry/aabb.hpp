@@ -0,0 +1,70 @@
+#pragma once
+
+#include <limits>
+#include <glm/glm.hpp>
+#include "ray.hpp"
+
+// \brief Axis aligned bounding box, used by the acceleration structures
+struct AABB
+{
+	glm::vec2 min = glm::vec2(std::numeric_limits<float>::max());
+	glm::vec2 max = glm::vec2(-std::numeric_limits<float>::max());
+
+	/// \brief Create empty (inverted) box.
+	AABB() noexcept = default;
+
+	/// \brief Create from min and max corner.
+	AABB(const glm::vec2& _min, const glm::vec2& _max) noexcept : min(_min), max(_max)
+	{
+	}
+
+	void grow(const glm::vec2& p)
+	{
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+
+	void grow(const AABB& box)
+	{
+		min = glm::min(min, box.min);
+		max = glm::max(max, box.max);
+	}
+
+	bool is_empty() const { return min.x > max.x || min.y > max.y; }
+	glm::vec2 center() const { return (min + max) * 0.5f; }
+	glm::vec2 extent() const { return max - min; }
+
+	/// the 2d equivalent of the surface area (used by the SAH)
+	float half_perimeter() const
+	{
+		if (is_empty())
+		{
+			return 0.0f;
+		}
+		const glm::vec2 e = extent();
+		return e.x + e.y;
+	}
+
+	/// distance from a point to the closest point of the box (0 inside)
+	float distance(const glm::vec2& p) const
+	{
+		return glm::length(p - glm::clamp(p, min, max));
+	}
+
+	/// slab test
+	/// \param [in] ray The ray.
+	/// \param [in] inv_dir 1 / ray.direction (precomputed once per ray)
+	/// \param [in] t_max Only hits closer than t_max count
+	/// \param [out] t_near Distance where the ray enters the box (may be negative if origin is inside)
+	bool intersect(const Ray& ray, const glm::vec2& inv_dir, float t_max, float& t_near) const
+	{
+		const glm::vec2 t1 = (min - ray.origin) * inv_dir;
+		const glm::vec2 t2 = (max - ray.origin) * inv_dir;
+		const glm::vec2 t_lo = glm::min(t1, t2);
+		const glm::vec2 t_hi = glm::max(t1, t2);
+
+		t_near = glm::max(t_lo.x, t_lo.y);
+		const float t_far = glm::min(t_hi.x, t_hi.y);
+		return t_near <= t_far && t_far >= 0.0f && t_near < t_max;
+	}
+};
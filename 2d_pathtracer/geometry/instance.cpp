@@ -0,0 +1,247 @@
+#include "instance.hpp"
+
+#include <cmath>
+
+#include "2dmath.hpp"
+#include "ray.hpp"
+#include "intersections.hpp"
+
+Prototype::Prototype(const std::vector<std::shared_ptr<Primitive>>& _primitives)
+{
+	for (const auto& primitive : _primitives)
+	{
+		m_pools.add(primitive);
+	}
+	const std::vector<AABB> bounds = m_pools.get_all_bounds();
+	for (const auto& primitive_bounds : bounds)
+	{
+		m_bounds.grow(primitive_bounds);
+	}
+	m_bvh.build(bounds);
+
+	//all primitives of an instance share its id, so where two of them cross the front of the instance
+	//changes from one primitive to the other. straight edges only cross once, ellipses are tested against everything
+	const std::vector<PrimitiveHandle>& handles = m_pools.get_handles();
+	for (uint32_t i = 0; i < handles.size(); ++i)
+	{
+		const std::vector<Ellipse> ellipses = m_pools.get_outline_ellipses(handles[i]);
+		const std::vector<Edge> edges = m_pools.get_outline_edges(handles[i]);
+		m_bvh.for_each_overlap(bounds[i], [&](uint32_t j)
+			{
+				if (j == i)
+				{
+					return;
+				}
+				for (const auto& ellipse : ellipses)
+				{
+					const auto points = m_pools.get_ellipse_crossings(handles[j], ellipse);
+					m_crossings.insert(m_crossings.end(), points.begin(), points.end());
+				}
+				//every pair of edges once
+				if (j < i)
+				{
+					return;
+				}
+				for (const auto& other : m_pools.get_outline_edges(handles[j]))
+				{
+					for (const auto& edge : edges)
+					{
+						glm::vec2 crossing;
+						if (segment_crossing(edge.a, edge.b, other.a, other.b, crossing))
+						{
+							m_crossings.push_back(crossing);
+						}
+					}
+				}
+			});
+	}
+}
+
+bool Prototype::first_intersection(const Ray& ray, Intersection& isect) const
+{
+	return m_bvh.first_intersection(ray, isect, [this](const uint32_t* indices, uint32_t count, const Ray& r, Intersection& i)
+		{
+			return m_pools.intersect(indices, count, r, i);
+		});
+}
+
+bool Prototype::any_intersection(const Ray& ray, float max_dist) const
+{
+	return m_bvh.any_intersection(ray, max_dist, [this](const uint32_t* indices, uint32_t count, const Ray& r, float dist)
+		{
+			return m_pools.occluded(indices, count, r, dist);
+		});
+}
+
+Instance::Instance(std::shared_ptr<const Prototype> _prototype, const glm::mat2& _linear, const glm::vec2& _translation) :
+	m_prototype(std::move(_prototype)),
+	m_linear(_linear),
+	m_inv_linear(glm::inverse(_linear)),
+	m_translation(_translation)
+{
+	const PrimitivePools& primitives = m_prototype->get_primitives();
+	if (primitives.size() > 0)
+	{
+		color = primitives.get_color(primitives.get_handle(0));
+	}
+}
+
+float Instance::to_prototype(const Ray& ray, Ray& local_ray) const
+{
+	local_ray.origin = to_prototype(ray.origin);
+	local_ray.direction = m_inv_linear * ray.direction;
+	//primitives expect a normalized direction
+	const float scale = glm::length(local_ray.direction);
+	local_ray.direction /= scale;
+	return scale;
+}
+
+std::vector<glm::vec2> Instance::to_scene(const std::vector<glm::vec2>& points) const
+{
+	std::vector<glm::vec2> result;
+	result.reserve(points.size());
+	for (const auto& p : points)
+	{
+		result.push_back(to_scene(p));
+	}
+	return result;
+}
+
+bool Instance::first_intersection(const Ray& ray, Intersection& isect) const
+{
+	Ray local_ray;
+	const float scale = to_prototype(ray, local_ray);
+
+	Intersection local_isect;
+	local_isect.t_min = isect.t_min * scale;
+	local_isect.t_max = isect.t_max * scale;
+	if (!m_prototype->first_intersection(local_ray, local_isect))
+	{
+		return false;
+	}
+
+	isect.t_max = local_isect.t_max / scale;
+	//normals transform with the inverse transpose
+	isect.normal = glm::normalize(glm::transpose(m_inv_linear) * local_isect.normal);
+	isect.material_id = local_isect.material_id;
+	return true;
+}
+
+bool Instance::any_interscetion(const Ray& ray, float max_dist) const
+{
+	Ray local_ray;
+	const float scale = to_prototype(ray, local_ray);
+	return m_prototype->any_intersection(local_ray, max_dist * scale);
+}
+
+std::vector<glm::vec2> Instance::get_draw_vertices() const
+{
+	const PrimitivePools& primitives = m_prototype->get_primitives();
+	std::vector<glm::vec2> vertices;
+	for (PrimitiveHandle handle : primitives.get_handles())
+	{
+		const auto points = to_scene(primitives.get_draw_vertices(handle));
+		vertices.insert(vertices.end(), points.begin(), points.end());
+	}
+	return vertices;
+}
+
+AABB Instance::get_bounds() const
+{
+	const AABB& local = m_prototype->get_bounds();
+	AABB bounds;
+	if (local.is_empty())
+	{
+		return bounds;
+	}
+	bounds.grow(to_scene(local.min));
+	bounds.grow(to_scene(local.max));
+	bounds.grow(to_scene(glm::vec2(local.min.x, local.max.y)));
+	bounds.grow(to_scene(glm::vec2(local.max.x, local.min.y)));
+	return bounds;
+}
+
+std::vector<glm::vec2> Instance::get_silhouette_points(glm::vec2 viewpoint) const
+{
+	//affine transforms keep tangents tangents, so the silhouettes can be found in prototype space
+	const glm::vec2 local_viewpoint = to_prototype(viewpoint);
+	const PrimitivePools& primitives = m_prototype->get_primitives();
+	std::vector<glm::vec2> points;
+	for (PrimitiveHandle handle : primitives.get_handles())
+	{
+		const auto local_points = primitives.get_silhouette_points(handle, local_viewpoint);
+		for (const auto& p : local_points)
+		{
+			points.push_back(to_scene(p));
+		}
+	}
+	//the front of the instance changes between its primitives where they cross
+	for (const auto& p : m_prototype->get_crossings())
+	{
+		points.push_back(to_scene(p));
+	}
+	return points;
+}
+
+std::vector<glm::vec2> Instance::get_ellipse_crossings(const Ellipse& _ellipse) const
+{
+	//affine transforms keep ellipses ellipses, so the crossings can be found in prototype space
+	const Ellipse local_ellipse{ to_prototype(_ellipse.center), m_inv_linear * _ellipse.axes };
+	const PrimitivePools& primitives = m_prototype->get_primitives();
+	std::vector<glm::vec2> crossings;
+	for (PrimitiveHandle handle : primitives.get_handles())
+	{
+		for (const auto& p : primitives.get_ellipse_crossings(handle, local_ellipse))
+		{
+			crossings.push_back(to_scene(p));
+		}
+	}
+	return crossings;
+}
+
+std::vector<Ellipse> Instance::get_outline_ellipses() const
+{
+	const PrimitivePools& primitives = m_prototype->get_primitives();
+	std::vector<Ellipse> ellipses;
+	for (PrimitiveHandle handle : primitives.get_handles())
+	{
+		for (const auto& ellipse : primitives.get_outline_ellipses(handle))
+		{
+			ellipses.push_back(Ellipse{ to_scene(ellipse.center), m_linear * ellipse.axes });
+		}
+	}
+	return ellipses;
+}
+
+std::vector<Edge> Instance::get_outline_edges() const
+{
+	const PrimitivePools& primitives = m_prototype->get_primitives();
+	std::vector<Edge> edges;
+	for (PrimitiveHandle handle : primitives.get_handles())
+	{
+		for (const auto& edge : primitives.get_outline_edges(handle))
+		{
+			edges.push_back(Edge{ to_scene(edge.a), to_scene(edge.b) });
+		}
+	}
+	return edges;
+}
+
+bool Instance::is_point_inside(glm::vec2 point) const
+{
+	const glm::vec2 local_point = to_prototype(point);
+	const PrimitivePools& primitives = m_prototype->get_primitives();
+	for (PrimitiveHandle handle : primitives.get_handles())
+	{
+		if (primitives.is_point_inside(handle, local_point))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void Instance::move(float dx, float dy)
+{
+	m_translation += glm::vec2(dx, dy);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "primitive.hpp"
+#include "primitive_pools.hpp"
+#include "../accelerators/bvh.hpp"
+
+/// \brief Group of primitives that is placed in the scene many times by instances
+///
+/// The primitives and their materials exist once, the prototype has its own BVH (bottom level)
+/// in prototype space. The scene acceleration structure over the instances is the top level.
+class Prototype
+{
+public:
+	/// \brief Copy primitives in prototype space into the pools and build the BVH
+	explicit Prototype(const std::vector<std::shared_ptr<Primitive>>& _primitives);
+
+	bool first_intersection(const Ray& ray, Intersection& isect) const;
+	bool any_intersection(const Ray& ray, float max_dist) const;
+
+	const PrimitivePools& get_primitives() const { return m_pools; }
+	const AABB& get_bounds() const { return m_bounds; }
+	/// \brief Points in prototype space where the outlines of two primitives of the prototype cross
+	const std::vector<glm::vec2>& get_crossings() const { return m_crossings; }
+
+private:
+	PrimitivePools m_pools;
+	BVH m_bvh;
+	AABB m_bounds;
+	std::vector<glm::vec2> m_crossings;
+};
+
+/// \brief A prototype placed in the scene with a 2D affine transform (scene = linear * prototype + translation)
+///
+/// Rays are transformed into prototype space, so an instance only costs the transform.
+class Instance : public Primitive
+{
+public:
+	Instance(std::shared_ptr<const Prototype> _prototype, const glm::mat2& _linear, const glm::vec2& _translation);
+
+	bool first_intersection(const Ray& ray, Intersection& isect) const override;
+	bool any_interscetion(const Ray& ray, float max_dist) const override;
+	std::vector<glm::vec2> get_draw_vertices() const override;
+	AABB get_bounds() const override;
+	std::vector<glm::vec2> get_silhouette_points(glm::vec2 viewpoint) const override;
+	std::vector<glm::vec2> get_ellipse_crossings(const Ellipse& ellipse) const override;
+	std::vector<Ellipse> get_outline_ellipses() const override;
+	std::vector<Edge> get_outline_edges() const override;
+	bool is_point_inside(glm::vec2) const override;
+	void move(float dx, float dy) override;
+	std::shared_ptr<Primitive> clone() const override { return std::make_shared<Instance>(*this); }
+
+	const Prototype& get_prototype() const { return *m_prototype; }
+
+	glm::vec2 to_scene(glm::vec2 p) const { return m_linear * p + m_translation; }
+	glm::vec2 to_prototype(glm::vec2 p) const { return m_inv_linear * (p - m_translation); }
+
+private:
+	//transforms a ray into prototype space, distances along the ray are scaled by the returned factor
+	float to_prototype(const Ray& ray, Ray& local_ray) const;
+	std::vector<glm::vec2> to_scene(const std::vector<glm::vec2>& points) const;
+
+	std::shared_ptr<const Prototype> m_prototype;
+	glm::mat2 m_linear;
+	glm::mat2 m_inv_linear;
+	glm::vec2 m_translation;
+};
@@ -1,26 +1,36 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <limits>
 #include <glm/glm.hpp>
 #include <memory>
-#include "../materials/material.hpp"
+
+//hits closer than this to the ray origin are ignored by default
+constexpr float DEFAULT_T_MIN = 1e-4f;
+//material id of primitives without material
+constexpr uint32_t NO_MATERIAL = std::numeric_limits<uint32_t>::max();
 
 struct Intersection
 {
 	glm::vec2 normal;
-	std::shared_ptr<Material> material;
+	//index of the material in the material table of the scene (resolved at shading time)
+	uint32_t material_id;
 	float t_max;
 	float t_min;
+	//index of the hit primitive in the scene (set by the scene queries)
+	uint32_t primitive_id;
 	/// \brief Create uninitialized Intersection with t_max = FLOAT_MAX
-	Intersection() noexcept : normal(glm::vec2(0)), material(nullptr), t_max(std::numeric_limits<float>::max()),t_min(1e-4f)
+	Intersection() noexcept : normal(glm::vec2(0)), material_id(NO_MATERIAL), t_max(std::numeric_limits<float>::max()),t_min(DEFAULT_T_MIN),
+		primitive_id(std::numeric_limits<uint32_t>::max())
 	{
 	}
 
-	Intersection(const glm::vec2& _normal, const std::shared_ptr<Material> _material, float _tMax) noexcept : normal(_normal),
-	                                                                           material(_material),
+	Intersection(const glm::vec2& _normal, uint32_t _material_id, float _tMax) noexcept : normal(_normal),
+	                                                                           material_id(_material_id),
 	                                                                           t_max(_tMax),
-																				t_min(1e-4f)
+																				t_min(DEFAULT_T_MIN),
+																				primitive_id(std::numeric_limits<uint32_t>::max())
 	
 	{
 	}
@@ -1,12 +1,36 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <vector>
 #include <glm/glm.hpp>
+#include "aabb.hpp"
 
 struct Intersection;
 class Ray;
-class Material;
+
+// \brief ellipse in scene coordinates (center + axes * (cos t, sin t)), part of the outline of curved primitives.
+// a circle has axes = radius * identity, affine transforms (instances) keep ellipses ellipses
+struct Ellipse
+{
+	glm::vec2 center;
+	glm::mat2 axes;
+
+	AABB get_bounds() const
+	{
+		//largest x and y of axes * (cos t, sin t)
+		const glm::vec2 extent(glm::length(glm::vec2(axes[0].x, axes[1].x)), glm::length(glm::vec2(axes[0].y, axes[1].y)));
+		return AABB(center - extent, center + extent);
+	}
+};
+
+// \brief straight piece of the outline of a primitive in scene coordinates
+struct Edge
+{
+	glm::vec2 a;
+	glm::vec2 b;
+};
 
 class Primitive
 {
@@ -17,24 +41,43 @@ public:
 	//returns true if there is an intersection with distance at most max_dist
 	virtual bool any_interscetion(const Ray& r, float max_dist) const = 0;
 
-	virtual void set_material(std::shared_ptr<Material> material)
+	//set the index of the material in the material table of the scene
+	virtual void set_material(uint32_t material_id)
 	{
-		m_material = material;
+		m_material_id = material_id;
 	}
 
-	virtual const Material& getMaterial() const { return *m_material; }
+	uint32_t get_material() const { return m_material_id; }
 	virtual const glm::vec3& get_color() const { return color; }
 
 	//returns vertices in screen space coordinates to draw the primitive in scene renderer
 	virtual std::vector<glm::vec2> get_draw_vertices() const = 0;
 
+	//returns the bounding box in scene coordinates (used to build the acceleration structure)
+	virtual AABB get_bounds() const = 0;
+
+	//returns the points where rays from viewpoint graze the outline (the outline is only entered or left there)
+	virtual std::vector<glm::vec2> get_silhouette_points(glm::vec2 viewpoint) const = 0;
+
+	//returns the points where the outline of the primitive crosses an ellipse
+	virtual std::vector<glm::vec2> get_ellipse_crossings(const Ellipse& ellipse) const = 0;
+
+	//returns the ellipses of the outline, straight outlines have none
+	virtual std::vector<Ellipse> get_outline_ellipses() const { return {}; }
+
+	//returns the straight pieces of the outline, curved outlines have none
+	virtual std::vector<Edge> get_outline_edges() const { return {}; }
+
 	//check if a point is inside the primitive
 	virtual bool is_point_inside(glm::vec2) const = 0;
 
 	//move primitive in specified direction
 	virtual void move(float dx, float dy) = 0;
 
+	//returns a copy, edits of a scene replace a primitive by a moved copy (older scene versions keep the original)
+	virtual std::shared_ptr<Primitive> clone() const = 0;
+
 protected:
-	std::shared_ptr<Material> m_material;
+	uint32_t m_material_id = std::numeric_limits<uint32_t>::max();
 	glm::vec3 color{ 1.0f };
 };
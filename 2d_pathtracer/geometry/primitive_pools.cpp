@@ -0,0 +1,268 @@
+#include "primitive_pools.hpp"
+
+#include "2dtypes.hpp"
+
+uint32_t PrimitivePools::add(const std::shared_ptr<Primitive>& _primitive)
+{
+	const auto id = static_cast<uint32_t>(m_handles.size());
+	if (const auto* segment = dynamic_cast<const Segment*>(_primitive.get()))
+	{
+		const glm::vec2 edge = segment->b - segment->a;
+		const glm::vec2 normal = glm::normalize(glm::vec2(-edge.y, edge.x));
+		m_handles.emplace_back(PrimitiveType::SEGMENT, static_cast<uint32_t>(m_segments.id.size()));
+		m_segments.ax.push_back(segment->a.x);
+		m_segments.ay.push_back(segment->a.y);
+		m_segments.edge_x.push_back(edge.x);
+		m_segments.edge_y.push_back(edge.y);
+		m_segments.normal_x.push_back(normal.x);
+		m_segments.normal_y.push_back(normal.y);
+		m_segments.inv_length_sq.push_back(1.0f / glm::dot(edge, edge));
+		m_segments.id.push_back(id);
+	}
+	else if (const auto* sphere = dynamic_cast<const Sphere*>(_primitive.get()))
+	{
+		m_handles.emplace_back(PrimitiveType::SPHERE, static_cast<uint32_t>(m_spheres.id.size()));
+		m_spheres.center_x.push_back(sphere->center.x);
+		m_spheres.center_y.push_back(sphere->center.y);
+		m_spheres.radius_sq.push_back(sphere->radius * sphere->radius);
+		m_spheres.inv_radius.push_back(1.0f / sphere->radius);
+		m_spheres.id.push_back(id);
+	}
+	else if (const auto* box = dynamic_cast<const BBox*>(_primitive.get()))
+	{
+		m_handles.emplace_back(PrimitiveType::BOX, static_cast<uint32_t>(m_boxes.id.size()));
+		m_boxes.min_x.push_back(box->center.x - box->size.x);
+		m_boxes.min_y.push_back(box->center.y - box->size.y);
+		m_boxes.max_x.push_back(box->center.x + box->size.x);
+		m_boxes.max_y.push_back(box->center.y + box->size.y);
+		m_boxes.id.push_back(id);
+	}
+	else
+	{
+		m_handles.emplace_back(PrimitiveType::OTHER, static_cast<uint32_t>(m_others.size()));
+		m_others.push_back(_primitive);
+		m_other_ids.push_back(id);
+	}
+	m_materials.push_back(_primitive->get_material());
+	m_colors.push_back(_primitive->get_color());
+	return id;
+}
+
+uint32_t PrimitivePools::get_id(PrimitiveHandle _handle) const
+{
+	const uint32_t i = _handle.index();
+	switch (_handle.type())
+	{
+	case PrimitiveType::SEGMENT:
+		return m_segments.id[i];
+	case PrimitiveType::SPHERE:
+		return m_spheres.id[i];
+	case PrimitiveType::BOX:
+		return m_boxes.id[i];
+	default:
+		return m_other_ids[i];
+	}
+}
+
+template <typename FUNCTION>
+auto PrimitivePools::with_primitive(PrimitiveHandle _handle, FUNCTION&& _function) const
+{
+	//the editing functions are rare, the objects only live for one call
+	const uint32_t i = _handle.index();
+	switch (_handle.type())
+	{
+	case PrimitiveType::SEGMENT:
+	{
+		const glm::vec2 a(m_segments.ax[i], m_segments.ay[i]);
+		const glm::vec2 edge(m_segments.edge_x[i], m_segments.edge_y[i]);
+		return _function(Segment(a, a + edge, glm::vec3(1.0f)));
+	}
+	case PrimitiveType::SPHERE:
+	{
+		const glm::vec2 center(m_spheres.center_x[i], m_spheres.center_y[i]);
+		return _function(Sphere(center, std::sqrt(m_spheres.radius_sq[i]), glm::vec3(1.0f)));
+	}
+	case PrimitiveType::BOX:
+	{
+		const glm::vec2 min(m_boxes.min_x[i], m_boxes.min_y[i]);
+		const glm::vec2 max(m_boxes.max_x[i], m_boxes.max_y[i]);
+		return _function(BBox(0.5f * (min + max), 0.5f * (max - min), glm::vec3(1.0f)));
+	}
+	default:
+		return _function(*m_others[i]);
+	}
+}
+
+AABB PrimitivePools::get_bounds(PrimitiveHandle _handle) const
+{
+	return with_primitive(_handle, [](const Primitive& primitive) { return primitive.get_bounds(); });
+}
+
+std::vector<glm::vec2> PrimitivePools::get_draw_vertices(PrimitiveHandle _handle) const
+{
+	return with_primitive(_handle, [](const Primitive& primitive) { return primitive.get_draw_vertices(); });
+}
+
+std::vector<glm::vec2> PrimitivePools::get_silhouette_points(PrimitiveHandle _handle, glm::vec2 _viewpoint) const
+{
+	return with_primitive(_handle, [_viewpoint](const Primitive& primitive)
+		{
+			return primitive.get_silhouette_points(_viewpoint);
+		});
+}
+
+std::vector<glm::vec2> PrimitivePools::get_ellipse_crossings(PrimitiveHandle _handle, const Ellipse& _ellipse) const
+{
+	return with_primitive(_handle, [&_ellipse](const Primitive& primitive)
+		{
+			return primitive.get_ellipse_crossings(_ellipse);
+		});
+}
+
+std::vector<Ellipse> PrimitivePools::get_outline_ellipses(PrimitiveHandle _handle) const
+{
+	return with_primitive(_handle, [](const Primitive& primitive) { return primitive.get_outline_ellipses(); });
+}
+
+std::vector<Edge> PrimitivePools::get_outline_edges(PrimitiveHandle _handle) const
+{
+	return with_primitive(_handle, [](const Primitive& primitive) { return primitive.get_outline_edges(); });
+}
+
+bool PrimitivePools::is_point_inside(PrimitiveHandle _handle, glm::vec2 _point) const
+{
+	return with_primitive(_handle, [_point](const Primitive& primitive) { return primitive.is_point_inside(_point); });
+}
+
+std::vector<AABB> PrimitivePools::get_all_bounds() const
+{
+	std::vector<AABB> bounds;
+	bounds.reserve(m_handles.size());
+	for (PrimitiveHandle handle : m_handles)
+	{
+		bounds.push_back(get_bounds(handle));
+	}
+	return bounds;
+}
+
+void PrimitivePools::move(PrimitiveHandle _handle, glm::vec2 _delta)
+{
+	//the precomputed edges, normals and sizes do not change
+	const uint32_t i = _handle.index();
+	switch (_handle.type())
+	{
+	case PrimitiveType::SEGMENT:
+		m_segments.ax[i] += _delta.x;
+		m_segments.ay[i] += _delta.y;
+		break;
+	case PrimitiveType::SPHERE:
+		m_spheres.center_x[i] += _delta.x;
+		m_spheres.center_y[i] += _delta.y;
+		break;
+	case PrimitiveType::BOX:
+		m_boxes.min_x[i] += _delta.x;
+		m_boxes.min_y[i] += _delta.y;
+		m_boxes.max_x[i] += _delta.x;
+		m_boxes.max_y[i] += _delta.y;
+		break;
+	default:
+	{
+		auto moved = m_others[i]->clone();
+		moved->move(_delta.x, _delta.y);
+		m_others[i] = std::move(moved);
+		break;
+	}
+	}
+}
+
+void PrimitivePools::clear()
+{
+	m_segments = SegmentPool();
+	m_spheres = SpherePool();
+	m_boxes = BoxPool();
+	m_others.clear();
+	m_other_ids.clear();
+	m_handles.clear();
+	m_materials.clear();
+	m_colors.clear();
+}
+
+template <PrimitiveType TYPE>
+bool PrimitivePools::intersect_pool(const std::vector<uint32_t>& _ids, const Ray& _ray, Intersection& _isect) const
+{
+	bool hit_any = false;
+
+	//full batches load consecutive slots, the rest is gathered
+	const auto count = static_cast<uint32_t>(_ids.size());
+	uint32_t first = 0;
+	for (; first + simd::WIDTH <= count; first += simd::WIDTH)
+	{
+		hit_any |= closest_in_batch<TYPE, true>(&first, &_ids[first], simd::WIDTH, _ray, _isect);
+	}
+	if (first < count)
+	{
+		const int lanes = static_cast<int>(count - first);
+		uint32_t slots[simd::WIDTH];
+		for (int k = 0; k < simd::WIDTH; ++k)
+		{
+			slots[k] = first + (k < lanes ? k : 0);
+		}
+		hit_any |= closest_in_batch<TYPE, false>(slots, &_ids[first], lanes, _ray, _isect);
+	}
+	return hit_any;
+}
+
+template <PrimitiveType TYPE>
+bool PrimitivePools::occluded_pool(const std::vector<uint32_t>& _ids, const Ray& _ray, float _max_dist) const
+{
+	const auto count = static_cast<uint32_t>(_ids.size());
+	uint32_t first = 0;
+	for (; first + simd::WIDTH <= count; first += simd::WIDTH)
+	{
+		if (simd::movemask(intersect_batch<TYPE, true>(&first, simd::WIDTH, _ray, DEFAULT_T_MIN, _max_dist).mask) != 0)
+		{
+			return true;
+		}
+	}
+	if (first < count)
+	{
+		const int lanes = static_cast<int>(count - first);
+		uint32_t slots[simd::WIDTH];
+		for (int k = 0; k < simd::WIDTH; ++k)
+		{
+			slots[k] = first + (k < lanes ? k : 0);
+		}
+		return simd::movemask(intersect_batch<TYPE, false>(slots, lanes, _ray, DEFAULT_T_MIN, _max_dist).mask) != 0;
+	}
+	return false;
+}
+
+bool PrimitivePools::intersect_all(const Ray& _ray, Intersection& _isect) const
+{
+	bool hit_any = intersect_pool<PrimitiveType::SEGMENT>(m_segments.id, _ray, _isect);
+	hit_any |= intersect_pool<PrimitiveType::SPHERE>(m_spheres.id, _ray, _isect);
+	hit_any |= intersect_pool<PrimitiveType::BOX>(m_boxes.id, _ray, _isect);
+	for (uint32_t id : m_other_ids)
+	{
+		hit_any |= intersect(id, _ray, _isect);
+	}
+	return hit_any;
+}
+
+bool PrimitivePools::occluded_all(const Ray& _ray, float _max_dist) const
+{
+	if (occluded_pool<PrimitiveType::SEGMENT>(m_segments.id, _ray, _max_dist) ||
+		occluded_pool<PrimitiveType::SPHERE>(m_spheres.id, _ray, _max_dist) ||
+		occluded_pool<PrimitiveType::BOX>(m_boxes.id, _ray, _max_dist))
+	{
+		return true;
+	}
+	for (uint32_t id : m_other_ids)
+	{
+		if (occluded(id, _ray, _max_dist))
+		{
+			return true;
+		}
+	}
+	return false;
+}
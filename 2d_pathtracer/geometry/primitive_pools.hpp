@@ -0,0 +1,531 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "primitive.hpp"
+#include "ray.hpp"
+#include "intersections.hpp"
+#include "../utils/simd.hpp"
+
+enum class PrimitiveType : uint32_t
+{
+	SEGMENT,
+	SPHERE,
+	BOX,
+	// any other primitive (e.g. instances), intersected with a virtual call
+	OTHER
+};
+
+/// \brief Type and slot of a primitive in the pools, packed into 32 bits
+struct PrimitiveHandle
+{
+	static constexpr uint32_t TYPE_SHIFT = 30;
+	static constexpr uint32_t INDEX_MASK = (1u << TYPE_SHIFT) - 1;
+
+	uint32_t bits = 0;
+
+	PrimitiveHandle() noexcept = default;
+	PrimitiveHandle(PrimitiveType _type, uint32_t _index) noexcept :
+		bits(static_cast<uint32_t>(_type) << TYPE_SHIFT | (_index & INDEX_MASK))
+	{
+	}
+
+	PrimitiveType type() const { return static_cast<PrimitiveType>(bits >> TYPE_SHIFT); }
+	uint32_t index() const { return bits & INDEX_MASK; }
+};
+
+/// \brief Geometry of the primitives in structure of arrays layout, the only copy of it in a scene
+///
+/// The pools hold everything an intersection needs per type in contiguous arrays, with the per hit work precomputed,
+/// so the queries do not chase pointers or call virtual functions. Primitives without a pool (instances) are kept as
+/// objects. The queries address a primitive by its id (the order of add(), used by the acceleration structures),
+/// the UI and the renderer by its handle.
+class PrimitivePools
+{
+public:
+	/// \brief copy the geometry, material and color of a primitive into the pool of its type
+	/// \return id of the primitive
+	uint32_t add(const std::shared_ptr<Primitive>& _primitive);
+
+	void clear();
+	size_t size() const { return m_handles.size(); }
+	PrimitiveHandle get_handle(uint32_t _id) const { return m_handles[_id]; }
+	uint32_t get_id(PrimitiveHandle _handle) const;
+
+	/// handles of all primitives, in id order
+	const std::vector<PrimitiveHandle>& get_handles() const { return m_handles; }
+
+	/// the object of a primitive without a pool (handle type OTHER)
+	const Primitive& get_other(PrimitiveHandle _handle) const { return *m_others[_handle.index()]; }
+
+	//same as the functions of Primitive, computed from the pools
+	AABB get_bounds(PrimitiveHandle _handle) const;
+	const glm::vec3& get_color(PrimitiveHandle _handle) const { return m_colors[get_id(_handle)]; }
+	std::vector<glm::vec2> get_draw_vertices(PrimitiveHandle _handle) const;
+	std::vector<glm::vec2> get_silhouette_points(PrimitiveHandle _handle, glm::vec2 _viewpoint) const;
+	std::vector<glm::vec2> get_ellipse_crossings(PrimitiveHandle _handle, const Ellipse& _ellipse) const;
+	std::vector<Ellipse> get_outline_ellipses(PrimitiveHandle _handle) const;
+	std::vector<Edge> get_outline_edges(PrimitiveHandle _handle) const;
+	bool is_point_inside(PrimitiveHandle _handle, glm::vec2 _point) const;
+
+	/// bounds of all primitives in id order (input of the acceleration structures)
+	std::vector<AABB> get_all_bounds() const;
+
+	/// \brief move a primitive, a primitive without a pool is replaced by a moved copy (copies of the pools share the object)
+	void move(PrimitiveHandle _handle, glm::vec2 _delta);
+
+	/// like Primitive::first_intersection, but sets isect.primitive_id
+	bool intersect(uint32_t _id, const Ray& _ray, Intersection& _isect) const;
+
+	/// like Primitive::any_interscetion
+	bool occluded(uint32_t _id, const Ray& _ray, float _max_dist) const;
+
+	/// closest hit of a batch of primitives (e.g. a BVH leaf), segments, spheres and boxes are tested simd::WIDTH at a time
+	/// \param [in] _ids primitive ids
+	/// \param [in] _count number of ids
+	bool intersect(const uint32_t* _ids, uint32_t _count, const Ray& _ray, Intersection& _isect) const;
+
+	/// any hit of a batch of primitives closer than _max_dist
+	bool occluded(const uint32_t* _ids, uint32_t _count, const Ray& _ray, float _max_dist) const;
+
+	/// closest hit of all primitives, streams through the pools without indirection
+	bool intersect_all(const Ray& _ray, Intersection& _isect) const;
+
+	/// any hit of all primitives closer than _max_dist
+	bool occluded_all(const Ray& _ray, float _max_dist) const;
+
+private:
+	/// only computes the distance, the normal is computed for the closest hit
+	bool intersect_distance(PrimitiveHandle _handle, const Ray& _ray, float _t_min, float _t_max, float& _t) const;
+
+	/// writes normal, distance, material and id of a hit
+	void set_hit(uint32_t _id, const Ray& _ray, float _t, Intersection& _isect) const;
+
+	/// result of a batch kernel, one lane per primitive
+	struct BatchHit
+	{
+		// all bits set in the lanes that are hit in the interval
+		simd::vfloat mask;
+		simd::vfloat t;
+		simd::vfloat normal_x, normal_y;
+	};
+
+	/// slots of up to simd::WIDTH primitives of one type, collected from a mixed batch
+	struct SlotBatch
+	{
+		uint32_t slots[simd::WIDTH];
+		uint32_t ids[simd::WIDTH];
+		int count = 0;
+	};
+
+	/// tests the ray against simd::WIDTH primitives of one type, normals are computed for all lanes without branches
+	/// \param [in] _slots slots of the lanes in the pool of TYPE (simd::WIDTH entries, lanes >= _count are ignored).
+	///		With CONTIGUOUS the lanes are the simd::WIDTH slots starting at _slots[0].
+	template <PrimitiveType TYPE, bool CONTIGUOUS>
+	BatchHit intersect_batch(const uint32_t* _slots, int _count, const Ray& _ray, float _t_min, float _t_max) const;
+
+	/// writes the hit of the closest lane to _isect, returns false if no lane is closer than _isect.t_max
+	template <PrimitiveType TYPE, bool CONTIGUOUS>
+	bool closest_in_batch(const uint32_t* _slots, const uint32_t* _ids, int _count, const Ray& _ray,
+	                      Intersection& _isect) const;
+
+	/// runs the kernel of _type on a collected batch and empties it
+	bool closest_in_batch(SlotBatch& _batch, PrimitiveType _type, const Ray& _ray, Intersection& _isect) const;
+	bool occluded_in_batch(SlotBatch& _batch, PrimitiveType _type, const Ray& _ray, float _max_dist) const;
+
+	/// closest hit and any hit of a whole pool, full batches are loaded contiguously
+	template <PrimitiveType TYPE>
+	bool intersect_pool(const std::vector<uint32_t>& _ids, const Ray& _ray, Intersection& _isect) const;
+	template <PrimitiveType TYPE>
+	bool occluded_pool(const std::vector<uint32_t>& _ids, const Ray& _ray, float _max_dist) const;
+
+	/// calls _function with the primitive of a handle, pooled primitives are rebuilt as temporary objects
+	template <typename FUNCTION>
+	auto with_primitive(PrimitiveHandle _handle, FUNCTION&& _function) const;
+
+	//components in separate arrays, so simd::WIDTH primitives are loaded with one instruction per component
+	struct SegmentPool
+	{
+		std::vector<float> ax, ay;
+		// b - a
+		std::vector<float> edge_x, edge_y;
+		std::vector<float> normal_x, normal_y;
+		std::vector<float> inv_length_sq;
+		std::vector<uint32_t> id;
+	};
+
+	struct SpherePool
+	{
+		std::vector<float> center_x, center_y;
+		std::vector<float> radius_sq;
+		std::vector<float> inv_radius;
+		std::vector<uint32_t> id;
+	};
+
+	struct BoxPool
+	{
+		std::vector<float> min_x, min_y;
+		std::vector<float> max_x, max_y;
+		std::vector<uint32_t> id;
+	};
+
+	SegmentPool m_segments;
+	SpherePool m_spheres;
+	BoxPool m_boxes;
+	std::vector<std::shared_ptr<const Primitive>> m_others;
+	std::vector<uint32_t> m_other_ids;
+
+	// per primitive id
+	std::vector<PrimitiveHandle> m_handles;
+	std::vector<uint32_t> m_materials;
+	//outline color of the scene renderer
+	std::vector<glm::vec3> m_colors;
+};
+
+
+inline bool PrimitivePools::intersect_distance(PrimitiveHandle _handle, const Ray& _ray, float _t_min, float _t_max,
+                                               float& _t) const
+{
+	const uint32_t i = _handle.index();
+	switch (_handle.type())
+	{
+	case PrimitiveType::SEGMENT:
+	{
+		const glm::vec2 n(m_segments.normal_x[i], m_segments.normal_y[i]);
+		const glm::vec2 to_a = glm::vec2(m_segments.ax[i], m_segments.ay[i]) - _ray.origin;
+		_t = glm::dot(n, to_a) / glm::dot(n, _ray.direction);
+		//position of the hit along the segment in [0,1]
+		const glm::vec2 edge(m_segments.edge_x[i], m_segments.edge_y[i]);
+		const float u = glm::dot(edge, _ray.direction * _t - to_a) * m_segments.inv_length_sq[i];
+		return _t >= _t_min && _t < _t_max && u >= 0.0f && u <= 1.0f;
+	}
+	case PrimitiveType::SPHERE:
+	{
+		const glm::vec2 p = _ray.origin - glm::vec2(m_spheres.center_x[i], m_spheres.center_y[i]);
+		const float B = glm::dot(p, _ray.direction);
+		const glm::vec2 closest = p - B * _ray.direction;
+		const float det_sq = m_spheres.radius_sq[i] - glm::dot(closest, closest);
+		if (det_sq < 0.0f)
+		{
+			return false;
+		}
+		const float det = std::sqrt(det_sq);
+		_t = -B - det;
+		if (_t <= _t_min || _t >= _t_max)
+		{
+			_t = -B + det;
+		}
+		return _t > _t_min && _t < _t_max;
+	}
+	case PrimitiveType::BOX:
+	{
+		const glm::vec2 inv_dir = glm::vec2(1.0f) / _ray.direction;
+		const glm::vec2 t1 = (glm::vec2(m_boxes.min_x[i], m_boxes.min_y[i]) - _ray.origin) * inv_dir;
+		const glm::vec2 t2 = (glm::vec2(m_boxes.max_x[i], m_boxes.max_y[i]) - _ray.origin) * inv_dir;
+		const float t_near = glm::max(_t_min, glm::max(glm::min(t1.x, t2.x), glm::min(t1.y, t2.y)));
+		const float t_far = glm::min(_t_max, glm::min(glm::max(t1.x, t2.x), glm::max(t1.y, t2.y)));
+		if (t_far < t_near)
+		{
+			return false;
+		}
+		//from inside the box the ray hits the far side
+		_t = t_near == _t_min ? t_far : t_near;
+		return _t < _t_max;
+	}
+	default:
+		return false;
+	}
+}
+
+inline void PrimitivePools::set_hit(uint32_t _id, const Ray& _ray, float _t, Intersection& _isect) const
+{
+	const PrimitiveHandle handle = m_handles[_id];
+	const uint32_t i = handle.index();
+	switch (handle.type())
+	{
+	case PrimitiveType::SEGMENT:
+		_isect.normal = glm::vec2(m_segments.normal_x[i], m_segments.normal_y[i]);
+		break;
+	case PrimitiveType::SPHERE:
+		_isect.normal = (_ray.origin + _ray.direction * _t - glm::vec2(m_spheres.center_x[i], m_spheres.center_y[i])) *
+			m_spheres.inv_radius[i];
+		break;
+	default:
+	{
+		//same slab selection as the batch kernel
+		const glm::vec2 inv_dir = glm::vec2(1.0f) / _ray.direction;
+		const glm::vec2 t1 = (glm::vec2(m_boxes.min_x[i], m_boxes.min_y[i]) - _ray.origin) * inv_dir;
+		const glm::vec2 t2 = (glm::vec2(m_boxes.max_x[i], m_boxes.max_y[i]) - _ray.origin) * inv_dir;
+		const glm::vec2 t_near = glm::min(t1, t2);
+		const glm::vec2 t_far = glm::max(t1, t2);
+		const bool inside = glm::max(t_near.x, t_near.y) <= _isect.t_min;
+		const bool x_slab = inside ? t_far.x <= t_far.y : t_near.x >= t_near.y;
+		const glm::vec2 side = (inside ? 1.0f : -1.0f) * glm::sign(_ray.direction);
+		_isect.normal = x_slab ? glm::vec2(side.x, 0.0f) : glm::vec2(0.0f, side.y);
+		break;
+	}
+	}
+
+	_isect.t_max = _t;
+	_isect.material_id = m_materials[_id];
+	_isect.primitive_id = _id;
+}
+
+inline bool PrimitivePools::intersect(uint32_t _id, const Ray& _ray, Intersection& _isect) const
+{
+	const PrimitiveHandle handle = m_handles[_id];
+	if (handle.type() == PrimitiveType::OTHER)
+	{
+		if (!m_others[handle.index()]->first_intersection(_ray, _isect))
+		{
+			return false;
+		}
+		_isect.primitive_id = _id;
+		return true;
+	}
+
+	float t;
+	if (!intersect_distance(handle, _ray, _isect.t_min, _isect.t_max, t))
+	{
+		return false;
+	}
+	set_hit(_id, _ray, t, _isect);
+	return true;
+}
+
+inline bool PrimitivePools::occluded(uint32_t _id, const Ray& _ray, float _max_dist) const
+{
+	const PrimitiveHandle handle = m_handles[_id];
+	if (handle.type() == PrimitiveType::OTHER)
+	{
+		return m_others[handle.index()]->any_interscetion(_ray, _max_dist);
+	}
+
+	float t;
+	return intersect_distance(handle, _ray, DEFAULT_T_MIN, _max_dist, t);
+}
+
+template <PrimitiveType TYPE, bool CONTIGUOUS>
+PrimitivePools::BatchHit PrimitivePools::intersect_batch(const uint32_t* _slots, int _count, const Ray& _ray,
+                                                         float _t_min, float _t_max) const
+{
+	using simd::vfloat;
+	const auto load = [_slots](const std::vector<float>& v)
+	{
+		return CONTIGUOUS ? vfloat::load(v.data() + _slots[0]) : vfloat::gather(v.data(), _slots);
+	};
+
+	const vfloat ox = vfloat::broadcast(_ray.origin.x);
+	const vfloat oy = vfloat::broadcast(_ray.origin.y);
+	const vfloat dx = vfloat::broadcast(_ray.direction.x);
+	const vfloat dy = vfloat::broadcast(_ray.direction.y);
+	const vfloat t_min = vfloat::broadcast(_t_min);
+	const vfloat t_max = vfloat::broadcast(_t_max);
+	const vfloat zero = vfloat::broadcast(0.0f);
+
+	//same math as the scalar kernels in intersect_distance
+	BatchHit hit;
+	if constexpr (TYPE == PrimitiveType::SEGMENT)
+	{
+		hit.normal_x = load(m_segments.normal_x);
+		hit.normal_y = load(m_segments.normal_y);
+		const vfloat to_ax = load(m_segments.ax) - ox;
+		const vfloat to_ay = load(m_segments.ay) - oy;
+
+		//lanes with parallel rays get inf or nan and fail the compares
+		hit.t = (hit.normal_x * to_ax + hit.normal_y * to_ay) / (hit.normal_x * dx + hit.normal_y * dy);
+		const vfloat u = (load(m_segments.edge_x) * (dx * hit.t - to_ax) + load(m_segments.edge_y) * (dy * hit.t - to_ay)) *
+			load(m_segments.inv_length_sq);
+		hit.mask = (hit.t >= t_min) & (hit.t < t_max) & (u >= zero) & (u <= vfloat::broadcast(1.0f));
+	}
+	else if constexpr (TYPE == PrimitiveType::SPHERE)
+	{
+		const vfloat px = ox - load(m_spheres.center_x);
+		const vfloat py = oy - load(m_spheres.center_y);
+		const vfloat B = px * dx + py * dy;
+		const vfloat closest_x = px - B * dx;
+		const vfloat closest_y = py - B * dy;
+		const vfloat det_sq = load(m_spheres.radius_sq) - (closest_x * closest_x + closest_y * closest_y);
+		const vfloat det = simd::sqrt(simd::max(det_sq, zero));
+
+		//the near hit, or the far one if the near one is outside the interval (origin inside the circle)
+		const vfloat t_near = zero - B - det;
+		hit.t = simd::select((t_near > t_min) & (t_near < t_max), t_near, det - B);
+		hit.mask = (det_sq >= zero) & (hit.t > t_min) & (hit.t < t_max);
+
+		const vfloat inv_radius = load(m_spheres.inv_radius);
+		hit.normal_x = (px + dx * hit.t) * inv_radius;
+		hit.normal_y = (py + dy * hit.t) * inv_radius;
+	}
+	else
+	{
+		static_assert(TYPE == PrimitiveType::BOX, "no batch kernel for this primitive type");
+		const vfloat inv_dx = vfloat::broadcast(1.0f / _ray.direction.x);
+		const vfloat inv_dy = vfloat::broadcast(1.0f / _ray.direction.y);
+		const vfloat tx1 = (load(m_boxes.min_x) - ox) * inv_dx;
+		const vfloat tx2 = (load(m_boxes.max_x) - ox) * inv_dx;
+		const vfloat ty1 = (load(m_boxes.min_y) - oy) * inv_dy;
+		const vfloat ty2 = (load(m_boxes.max_y) - oy) * inv_dy;
+		const vfloat near_x = simd::min(tx1, tx2);
+		const vfloat far_x = simd::max(tx1, tx2);
+		const vfloat near_y = simd::min(ty1, ty2);
+		const vfloat far_y = simd::max(ty1, ty2);
+		const vfloat t_near = simd::max(near_x, near_y);
+		const vfloat t_far = simd::min(far_x, far_y);
+
+		//from inside the box the ray hits the far side
+		const vfloat inside = t_near <= t_min;
+		hit.t = simd::select(inside, t_far, t_near);
+		hit.mask = (t_far >= simd::select(inside, t_min, t_near)) & (hit.t < t_max);
+
+		//the normal belongs to the slab that limits the interval (the later entry or the earlier exit),
+		//it points against the ray on entry and along the ray on exit
+		const vfloat x_slab = simd::select(inside, far_x <= far_y, near_x >= near_y);
+		const vfloat sign_x = vfloat::broadcast(_ray.direction.x < 0.0f ? -1.0f : 1.0f);
+		const vfloat sign_y = vfloat::broadcast(_ray.direction.y < 0.0f ? -1.0f : 1.0f);
+		hit.normal_x = simd::select(x_slab, simd::select(inside, sign_x, zero - sign_x), zero);
+		hit.normal_y = simd::select(x_slab, zero, simd::select(inside, sign_y, zero - sign_y));
+	}
+
+	hit.mask = hit.mask & simd::lane_mask(_count);
+	return hit;
+}
+
+template <PrimitiveType TYPE, bool CONTIGUOUS>
+bool PrimitivePools::closest_in_batch(const uint32_t* _slots, const uint32_t* _ids, int _count, const Ray& _ray,
+                                      Intersection& _isect) const
+{
+	const BatchHit hit = intersect_batch<TYPE, CONTIGUOUS>(_slots, _count, _ray, _isect.t_min, _isect.t_max);
+	if (simd::movemask(hit.mask) == 0)
+	{
+		return false;
+	}
+
+	//masked closest hit, the first lane wins on ties like in the scalar loop
+	const simd::vfloat masked = simd::select(hit.mask, hit.t,
+	                                         simd::vfloat::broadcast(std::numeric_limits<float>::infinity()));
+	const float t_closest = simd::reduce_min(masked);
+	const int lane = simd::first_lane(simd::movemask(masked == simd::vfloat::broadcast(t_closest)));
+
+	_isect.t_max = t_closest;
+	_isect.normal = glm::vec2(simd::extract(hit.normal_x, lane), simd::extract(hit.normal_y, lane));
+	_isect.material_id = m_materials[_ids[lane]];
+	_isect.primitive_id = _ids[lane];
+	return true;
+}
+
+inline bool PrimitivePools::closest_in_batch(SlotBatch& _batch, PrimitiveType _type, const Ray& _ray,
+                                             Intersection& _isect) const
+{
+	//unused lanes load a valid slot and are masked out
+	for (int k = _batch.count; k < simd::WIDTH; ++k)
+	{
+		_batch.slots[k] = _batch.slots[0];
+	}
+
+	const int count = _batch.count;
+	_batch.count = 0;
+	switch (_type)
+	{
+	case PrimitiveType::SEGMENT:
+		return closest_in_batch<PrimitiveType::SEGMENT, false>(_batch.slots, _batch.ids, count, _ray, _isect);
+	case PrimitiveType::SPHERE:
+		return closest_in_batch<PrimitiveType::SPHERE, false>(_batch.slots, _batch.ids, count, _ray, _isect);
+	default:
+		return closest_in_batch<PrimitiveType::BOX, false>(_batch.slots, _batch.ids, count, _ray, _isect);
+	}
+}
+
+inline bool PrimitivePools::occluded_in_batch(SlotBatch& _batch, PrimitiveType _type, const Ray& _ray,
+                                              float _max_dist) const
+{
+	for (int k = _batch.count; k < simd::WIDTH; ++k)
+	{
+		_batch.slots[k] = _batch.slots[0];
+	}
+
+	const int count = _batch.count;
+	_batch.count = 0;
+	switch (_type)
+	{
+	case PrimitiveType::SEGMENT:
+		return simd::movemask(intersect_batch<PrimitiveType::SEGMENT, false>(_batch.slots, count, _ray, DEFAULT_T_MIN,
+		                                                                     _max_dist).mask) != 0;
+	case PrimitiveType::SPHERE:
+		return simd::movemask(intersect_batch<PrimitiveType::SPHERE, false>(_batch.slots, count, _ray, DEFAULT_T_MIN,
+		                                                                    _max_dist).mask) != 0;
+	default:
+		return simd::movemask(intersect_batch<PrimitiveType::BOX, false>(_batch.slots, count, _ray, DEFAULT_T_MIN,
+		                                                                 _max_dist).mask) != 0;
+	}
+}
+
+inline bool PrimitivePools::intersect(const uint32_t* _ids, uint32_t _count, const Ray& _ray, Intersection& _isect) const
+{
+	bool hit_any = false;
+	//one batch per pool type, flushed when full. other primitives are tested right away
+	SlotBatch batches[3];
+	for (uint32_t k = 0; k < _count; ++k)
+	{
+		const PrimitiveHandle handle = m_handles[_ids[k]];
+		if (handle.type() == PrimitiveType::OTHER)
+		{
+			hit_any |= intersect(_ids[k], _ray, _isect);
+			continue;
+		}
+
+		SlotBatch& batch = batches[static_cast<uint32_t>(handle.type())];
+		batch.slots[batch.count] = handle.index();
+		batch.ids[batch.count] = _ids[k];
+		if (++batch.count == simd::WIDTH)
+		{
+			hit_any |= closest_in_batch(batch, handle.type(), _ray, _isect);
+		}
+	}
+
+	for (uint32_t type = 0; type < 3; ++type)
+	{
+		if (batches[type].count > 0)
+		{
+			hit_any |= closest_in_batch(batches[type], static_cast<PrimitiveType>(type), _ray, _isect);
+		}
+	}
+	return hit_any;
+}
+
+inline bool PrimitivePools::occluded(const uint32_t* _ids, uint32_t _count, const Ray& _ray, float _max_dist) const
+{
+	SlotBatch batches[3];
+	for (uint32_t k = 0; k < _count; ++k)
+	{
+		const PrimitiveHandle handle = m_handles[_ids[k]];
+		if (handle.type() == PrimitiveType::OTHER)
+		{
+			if (occluded(_ids[k], _ray, _max_dist))
+			{
+				return true;
+			}
+			continue;
+		}
+
+		SlotBatch& batch = batches[static_cast<uint32_t>(handle.type())];
+		batch.slots[batch.count] = handle.index();
+		if (++batch.count == simd::WIDTH && occluded_in_batch(batch, handle.type(), _ray, _max_dist))
+		{
+			return true;
+		}
+	}
+
+	for (uint32_t type = 0; type < 3; ++type)
+	{
+		if (batches[type].count > 0 && occluded_in_batch(batches[type], static_cast<PrimitiveType>(type), _ray, _max_dist))
+		{
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <glm/glm.hpp>
+
+#include "aabb.hpp"
+#include "ray.hpp"
+
+/// \brief Rays from a common origin with neighbouring directions (e.g. adjacent camera strata)
+struct RayPacket
+{
+	static constexpr uint32_t MAX_SIZE = 16;
+
+	glm::vec2 origin = glm::vec2(0.0f);
+	//normalized directions, sorted by angle (clockwise or counterclockwise)
+	glm::vec2 directions[MAX_SIZE];
+	uint32_t count = 0;
+	//camera packets: stratum of the first ray and sample index, for counter-based random numbers
+	uint32_t first_stratum = 0;
+	uint32_t sample = 0;
+
+	Ray ray(uint32_t k) const { return Ray(origin, directions[k]); }
+};
+
+/// \brief Angular wedge that contains all rays of a packet, used to cull acceleration structure nodes for the whole packet
+class RayWedge
+{
+public:
+	explicit RayWedge(const RayPacket& packet) : m_origin(packet.origin), m_valid(false)
+	{
+		if (packet.count == 0)
+		{
+			return;
+		}
+
+		//the outermost rays bound the wedge, upper is counterclockwise of lower
+		m_lower = packet.directions[0];
+		m_upper = packet.directions[packet.count - 1];
+		if (cross(m_lower, m_upper) < 0.0f)
+		{
+			std::swap(m_lower, m_upper);
+		}
+
+		//packets wider than 180 degrees (or unsorted ones) are not bounded by the two half planes
+		m_valid = true;
+		for (uint32_t k = 0; k < packet.count; ++k)
+		{
+			if (cross(m_lower, packet.directions[k]) < 0.0f || cross(packet.directions[k], m_upper) < 0.0f)
+			{
+				m_valid = false;
+				return;
+			}
+		}
+	}
+
+	/// true if no ray of the packet can hit the box
+	bool excludes(const AABB& box) const
+	{
+		if (!m_valid)
+		{
+			return false;
+		}
+
+		const glm::vec2 corners[4] = {
+			box.min - m_origin, box.max - m_origin,
+			glm::vec2(box.min.x, box.max.y) - m_origin, glm::vec2(box.max.x, box.min.y) - m_origin
+		};
+		//the box is completely clockwise of the lower ray or counterclockwise of the upper ray
+		bool below = true;
+		bool above = true;
+		for (const auto& c : corners)
+		{
+			below = below && cross(m_lower, c) < 0.0f;
+			above = above && cross(c, m_upper) < 0.0f;
+		}
+		return below || above;
+	}
+
+private:
+	static float cross(const glm::vec2& a, const glm::vec2& b) { return a.x * b.y - a.y * b.x; }
+
+	glm::vec2 m_origin;
+	glm::vec2 m_lower = glm::vec2(0.0f);
+	glm::vec2 m_upper = glm::vec2(0.0f);
+	bool m_valid;
+};
@@ -1,59 +1,115 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include "../../shared/framework/framework.h"
 #include "pathtracer.hpp"
 
-
-static void render_path(const gpupro::Program& _program, gpupro::Framebuffer& _framebuffer, gpupro::Pipeline& pipe,
-	const Scene& scene, std::vector<DrawData> draw_data)
+///
+/// \brief Draws the lines of the paths into the samples texture
+///
+/// The vertex arrays, the uniforms and the vertex buffers are created once. The DrawData records are streamed
+/// through a persistently mapped ring buffer, so a draw neither creates GL objects nor waits for an upload.
+/// Every record is one instance, the vertex shader generates both ends of its line.
+/// PackedDrawData records have their own vertex array and ring buffer and are decoded by the vertex shader.
+class PathRenderer
 {
-	//bind vao
-	gpupro::VertexArray vao;
-	//positions
-	vao.addBinding(/*cpp*/ 2, /*vertex.glsl*/ 0, gpupro::VertexType::FLOAT, 2);
-	//colors
-	vao.addBinding(/*cpp*/ 3, /*vertex.glsl*/ 1, gpupro::VertexType::FLOAT, 3);
-	vao.bind();
-	//apply pipeline
-	pipe.apply();
-	//bind framebuffer
-	_framebuffer.bind();
-	//bind program
-	_program.bind();
-
-	//set transformation uniform buffer 
-	gpupro::Buffer<TransformUniform> uniform_buffer(gpupro::BufferType::UNIFORM, 1);
-	const auto transform_uniform = scene.getTransformUniform();
-	uniform_buffer.subDataUpdate(transform_uniform);
-	uniform_buffer.bindAsUniformBuffer(1);
-
-	//create buffer for ray start flux
-	gpupro::Buffer<glm::vec3> flux_buffer(gpupro::BufferType::UNIFORM, draw_data.size() * 2);
-
-	//use Uniform Buffer as Vertex Buffer to use subDataUpdate
-	auto posBuffer = gpupro::Buffer<glm::vec2>(gpupro::BufferType::UNIFORM, draw_data.size() * 2);
-
-
-	std::vector<glm::vec2> positions;
-	std::vector<glm::vec3> colors;
-	//read all data into buffers
-	for (const DrawData& data : draw_data)
+public:
+	PathRenderer() :
+		uniform_buffer(gpupro::BufferType::UNIFORM, 1),
+		packed_uniform_buffer(gpupro::BufferType::UNIFORM, 1),
+		line_buffer(gpupro::Buffer<DrawData>::streaming(gpupro::BufferType::ARRAY, RING_LINES)),
+		packed_line_buffer(gpupro::Buffer<PackedDrawData>::streaming(gpupro::BufferType::ARRAY, RING_LINES))
+	{
+		//one DrawData per instance (28 bytes per line, the flux is not duplicated)
+		vao.addBinding(/*cpp*/ 2, /*vertex.glsl*/ 0, gpupro::VertexType::FLOAT, 2, offsetof(DrawData, start_point));
+		vao.addBinding(/*cpp*/ 2, /*vertex.glsl*/ 1, gpupro::VertexType::FLOAT, 2, offsetof(DrawData, end_point));
+		vao.addBinding(/*cpp*/ 2, /*vertex.glsl*/ 2, gpupro::VertexType::FLOAT, 3, offsetof(DrawData, start_flux));
+		vao.setDivisor(2, 1);
+
+		//one PackedDrawData per instance (12 bytes per line)
+		packed_vao.addBinding(/*cpp*/ 3, /*vertex.glsl*/ 3, gpupro::VertexType::UNSIGNED_SHORT, 4, offsetof(PackedDrawData, points));
+		packed_vao.addBinding(/*cpp*/ 3, /*vertex.glsl*/ 4, gpupro::VertexType::UNSIGNED_INT, 1, offsetof(PackedDrawData, start_flux));
+		packed_vao.setDivisor(3, 1);
+	}
+
+	/// \brief draw all lines with additive blending
+	/// \param [in] _program shader to draw the paths
+	/// \param [in] _scene for the transformation into [-1,1]
+	/// \param [in] _draw_data lines to draw
+	/// \param [in] _packed_draw_data lines to draw, packed with the size of _scene
+	void render(const gpupro::Program& _program, gpupro::Framebuffer& _framebuffer, gpupro::Pipeline& _pipe,
+	            const Scene& _scene, const std::vector<DrawData>& _draw_data,
+	            const std::vector<PackedDrawData>& _packed_draw_data)
+	{
+		//apply pipeline
+		_pipe.apply();
+		//bind framebuffer
+		_framebuffer.bind();
+		//bind program
+		_program.bind();
+
+		//set transformation uniform buffer (the scene size changes with the scene)
+		if (!_draw_data.empty())
+		{
+			uniform_buffer.subDataUpdate(PathUniform{ _scene.get_size(), 0, 0 });
+			uniform_buffer.bindAsUniformBuffer(1);
+			draw_lines(vao, line_buffer, 2, _draw_data);
+		}
+		if (!_packed_draw_data.empty())
+		{
+			packed_uniform_buffer.subDataUpdate(PathUniform{ _scene.get_size(), 1, 0 });
+			packed_uniform_buffer.bindAsUniformBuffer(1);
+			draw_lines(packed_vao, packed_line_buffer, 3, _packed_draw_data);
+		}
+	}
+
+private:
+	//transform block of path_vertex.glsl
+	struct PathUniform
+	{
+		glm::vec2 scene_size;
+		//lines are PackedDrawData
+		int packed;
+		//std140 blocks are rounded up to 16 bytes
+		int padding;
+	};
+
+	/// streams the lines through the ring buffer and draws them
+	/// \param [in] _binding binding index of the ring buffer in _vao
+	template <class T>
+	static void draw_lines(const gpupro::VertexArray& _vao, gpupro::Buffer<T>& _ring, GLuint _binding,
+	                       const std::vector<T>& _lines)
 	{
-		//add vertex start and end position of line
-		positions.emplace_back(data.start_point);
-		positions.emplace_back(data.end_point);
-		//add vertex color (for both vertices)
-		colors.emplace_back(data.start_flux);
-		colors.emplace_back(data.start_flux);
+		_vao.bind(); // needs to be called before binding the vertex buffers
+		_ring.bindAsVertexBuffer(_binding);
+
+		//a batch can be larger than a region of the ring, draw it in pieces
+		for (size_t first_line = 0; first_line < _lines.size(); first_line += BATCH_LINES)
+		{
+			const size_t num_lines = std::min(BATCH_LINES, _lines.size() - first_line);
+			GLuint first_instance = 0;
+			T* lines = _ring.streamReserve(GLuint(num_lines), first_instance);
+			std::copy_n(_lines.begin() + first_line, num_lines, lines);
+			//draw all lines, 2 vertices per instance
+			glDrawArraysInstancedBaseInstance(GL_LINES, 0, 2, GLsizei(num_lines), first_instance);
+		}
+		_ring.streamFence();
 	}
 
-	//upload to gpu
-	posBuffer.subDataUpdate(positions);
-	flux_buffer.subDataUpdate(colors);
-	vao.bind(); // needs to be called before binding the vertex buffers
-	//bind buffers
-	posBuffer.bindAsVertexBuffer(2);   //number specified by vao.addBinding()
-	flux_buffer.bindAsVertexBuffer(3); //number specified by vao.addBinding()
-	//draw all lines
-	glDrawArrays(GL_LINES, 0, posBuffer.getNumElements());
-}
+	//the records are read as they are by the vertex shader
+	static_assert(sizeof(DrawData) == 7 * sizeof(float), "DrawData must be tightly packed");
+	static_assert(sizeof(PackedDrawData) == 12, "PackedDrawData must be tightly packed");
+
+	//lines per ring buffer (3 regions)
+	static constexpr size_t RING_LINES = 3 * 65536;
+	//lines per draw call, fits into a region
+	static constexpr size_t BATCH_LINES = RING_LINES / 3;
+
+	gpupro::VertexArray vao;
+	gpupro::VertexArray packed_vao;
+	gpupro::Buffer<PathUniform> uniform_buffer;
+	gpupro::Buffer<PathUniform> packed_uniform_buffer;
+	gpupro::Buffer<DrawData> line_buffer;
+	gpupro::Buffer<PackedDrawData> packed_line_buffer;
+};
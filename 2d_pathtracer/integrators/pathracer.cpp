@@ -1,18 +1,35 @@
 #include "pathtracer.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <glm/glm.hpp>
 
 #include "../scene/scene.hpp"
 #include "../scene/light.hpp"
+#include "../materials/material.hpp"
 #include "../geometry/intersections.hpp"
 #include "../geometry/ray.hpp"
 #include "result_renderer.hpp"
 #include "path_renderer.hpp"
+#include "wavefront.hpp"
+#include "software_splatter.hpp"
 
 
 Pathtracer::Pathtracer(int width, int height, const gpupro::Program& _path_program) :
-	path_program(_path_program), num_iterations(0)
+	Pathtracer(width, height)
+{
+	gl_target = std::make_unique<GLTarget>(width, height, _path_program);
+}
+
+Pathtracer::Pathtracer(int width, int height) :
+	splatter(std::make_unique<SoftwareSplatter>(width, height)), num_iterations(0), draw_queue(DRAW_QUEUE_BLOCKS), gl_thread(std::this_thread::get_id()),
+	wavefront(std::make_unique<WavefrontIntegrator>())
+{
+}
+
+Pathtracer::GLTarget::GLTarget(int width, int height, const gpupro::Program& _path_program) :
+	path_program(_path_program), path_renderer(std::make_unique<PathRenderer>())
 {
 	add_samples_pipeline = gpupro::Pipeline();
 	//set up pipeline to additive blending
@@ -30,12 +47,94 @@ Pathtracer::Pathtracer(int width, int height, const gpupro::Program& _path_progr
 	samples_framebuffer.validate(); // validate once all textures were added	
 }
 
-/// 
-/// \brief Samples a ray from the camera and draws into samples_tex
-/// 
-/// \param _ray normalized camera ray
-void Pathtracer::sample(const Ray& _ray)
+Pathtracer::~Pathtracer() = default;
+
+Pathtracer::Worker::Worker() = default;
+
+Pathtracer::Worker::~Worker() = default;
+
+void Pathtracer::sample_packet(const RayPacket& _packet)
+{
+	if (settings.wavefront)
+	{
+		wavefront->add_camera_rays(_packet);
+		if (wavefront->size() >= WAVE_SIZE)
+		{
+			trace_wave();
+		}
+		return;
+	}
+
+	num_iterations += trace_packet(_packet, draw_data);
+	submit_draw_data(draw_data, false);
+}
+
+void Pathtracer::prepare_workers(uint32_t _num_workers)
+{
+	while (workers.size() < _num_workers)
+	{
+		workers.push_back(std::make_unique<Worker>());
+		workers.back()->wavefront = std::make_unique<WavefrontIntegrator>();
+	}
+	splatter->prepare_threads(_num_workers);
+}
+
+void Pathtracer::sample_packet(const RayPacket& _packet, uint32_t _worker)
+{
+	//only touches the state of the worker and const scene data
+	Worker& worker = *workers[_worker];
+	if (settings.wavefront)
+	{
+		worker.wavefront->add_camera_rays(_packet);
+		if (worker.wavefront->size() >= WAVE_SIZE)
+		{
+			worker.num_samples += static_cast<int>(worker.wavefront->trace(*m_scene, settings, worker.draw_data));
+			submit_draw_data(worker.draw_data, false, _worker);
+		}
+		return;
+	}
+	worker.num_samples += trace_packet(_packet, worker.draw_data);
+	submit_draw_data(worker.draw_data, false, _worker);
+}
+
+void Pathtracer::finish(uint32_t _worker)
+{
+	Worker& worker = *workers[_worker];
+	if (worker.wavefront->size() > 0)
+	{
+		worker.num_samples += static_cast<int>(worker.wavefront->trace(*m_scene, settings, worker.draw_data));
+	}
+	submit_draw_data(worker.draw_data, true, _worker);
+}
+
+void Pathtracer::idle()
+{
+	drain_draw_data();
+}
+
+int Pathtracer::trace_packet(const RayPacket& _packet, std::vector<DrawData>& _out)
 {
+	//the first hits of the whole packet are found together, the bounces are traced ray by ray
+	Intersection isects[RayPacket::MAX_SIZE];
+	bool hits[RayPacket::MAX_SIZE];
+	m_scene->first_camera_intersections(_packet, isects, hits);
+	int num_paths = 0;
+	for (uint32_t k = 0; k < _packet.count; ++k)
+	{
+		if (trace_path(_packet.ray(k), hits[k], isects[k], _packet.first_stratum + k, _packet.sample, _out))
+		{
+			++num_paths;
+		}
+	}
+	return num_paths;
+}
+
+bool Pathtracer::trace_path(const Ray& _ray, bool _first_hit, const Intersection& _first_isect,
+                            uint32_t _stratum, uint32_t _sample, std::vector<DrawData>& _out)
+{
+	//the random numbers of a path only depend on its stratum and sample, not on the thread that traces it
+	const SampleGenerator sampler(settings.sampler);
+
 	std::vector<PathSegment> path_segments;
 	bool any_hit = false;
 	Ray cur_ray = _ray;
@@ -45,8 +144,18 @@ void Pathtracer::sample(const Ray& _ray)
 	{
 		//trace current ray
 		Intersection isect;
+		bool hit;
+		if (i == 0)
+		{
+			isect = _first_isect;
+			hit = _first_hit;
+		}
+		else
+		{
+			hit = m_scene->first_intersection(cur_ray, isect);
+		}
 
-		if (m_scene->first_intersection(cur_ray, isect))
+		if (hit)
 		{
 			any_hit = true;
 
@@ -56,26 +165,48 @@ void Pathtracer::sample(const Ray& _ray)
 
 			//gather direct illumination (next event estimation)
 			glm::vec3 illumination(0.0f);
-			for (const auto& light : m_scene->getLights())
+			const auto& lights = m_scene->getLights();
+			const auto direct_light = [&](size_t light_index)
 			{
+				const auto& light = lights[light_index];
 				//direction and distance to light
 				glm::vec2 light_dir = light->pos - hit_pos;
 				float light_distance = glm::length(light_dir);
 				light_dir /= light_distance;
-				//ray from hitpos to light
-				Ray light_ray(hit_pos - RAY_EPSILON * cur_ray.direction, light_dir);
-				//check if light is visible
-				if (!m_scene->any_intersection(light_ray, light_distance - RAY_EPSILON))
+				//check if light is visible (shadow map lookup, shadow ray from hitpos to light if needed)
+				if (!m_scene->is_light_visible(light_index, hit_pos - RAY_EPSILON * cur_ray.direction, RAY_EPSILON))
 				{
-					// PointLight source is visible -> compute direct illumination with
-					// photometric distance law.
-					float cosE = abs(glm::dot(light_dir, isect.normal)); // abs = two sided material
-					glm::vec3 irradiance = light->intensity * cosE;
-					float attenuation = glm::max(1.0f, light_distance);
-					irradiance /= attenuation;
-					illumination += irradiance;
+					return glm::vec3(0.0f);
+				}
+				// PointLight source is visible -> compute direct illumination with
+				// photometric distance law.
+				float cosE = abs(glm::dot(light_dir, isect.normal)); // abs = two sided material
+				glm::vec3 irradiance = light->intensity * cosE;
+				float attenuation = glm::max(1.0f, light_distance);
+				return irradiance / attenuation;
+			};
+
+			if (settings.light_sampling == LightSampling::ALL)
+			{
+				for (size_t light_index = 0; light_index < lights.size(); ++light_index)
+				{
+					illumination += direct_light(light_index);
+				}
+			}
+			else if (!lights.empty())
+			{
+				//pick a few lights and weight them by the inverse probability
+				const int num_samples = std::max(1, settings.light_samples);
+				for (int s = 0; s < num_samples; ++s)
+				{
+					float light_pdf = 1.0f;
+					const uint32_t light_index = m_scene->sample_light(settings.light_sampling, hit_pos,
+						sampler.get(_stratum, _sample, SampleGenerator::light_dimension(i, s)), light_pdf);
+					if (light_pdf > 0.0f)
+					{
+						illumination += direct_light(light_index) / (light_pdf * num_samples);
+					}
 				}
-
 			}
 
 			//sample new direction 
@@ -83,15 +214,17 @@ void Pathtracer::sample(const Ray& _ray)
 			glm::vec2 t = glm::vec2(-isect.normal.y, isect.normal.x);
 			glm::vec2 wiLocal = -glm::vec2(glm::dot(t, cur_ray.direction), glm::dot(isect.normal, cur_ray.direction));
 
-			glm::vec2 woLocal = isect.material->sample_dir(wiLocal, isect.normal, pdf);
+			//resolve the material only now, the intersection queries just pass the id around
+			const Material& material = m_scene->get_material(isect.material_id);
+			glm::vec2 woLocal = material.sample_dir(wiLocal, isect.normal, sampler.get(_stratum, _sample, SampleGenerator::material_dimension(i)), pdf);
 			//transform from local to scene space
 			glm::vec new_dir = (woLocal.y * isect.normal + woLocal.x * t);
 
 			//sample material
-			const auto reflectance = (*isect.material)(-cur_ray.direction, new_dir, isect.normal) / pdf;
+			const auto reflectance = material(-cur_ray.direction, new_dir, isect.normal) / pdf;
 
 			//add light emitted from material (e.g. area light)
-			illumination += isect.material->get_self_emitting_value(isect.normal);
+			illumination += material.get_self_emitting_value(isect.normal);
 
 			//check if we only use pure importance
 			if (settings.pure_importance) {
@@ -115,16 +248,12 @@ void Pathtracer::sample(const Ray& _ray)
 				//add line to path_segments origin = cur_ray.origin, dest = light->pos, 
 
 				//check all point lights
-				for (const auto& light : m_scene->getLights())
+				const auto& lights = m_scene->getLights();
+				for (size_t light_index = 0; light_index < lights.size(); ++light_index)
 				{
-					//direction and distance to light
-					glm::vec2 light_dir = light->pos - cur_ray.origin;
-					float light_distance = glm::length(light_dir);
-					light_dir /= light_distance;
-					//ray from hitpos to light
-					Ray light_ray(cur_ray.origin, light_dir);
+					const auto& light = lights[light_index];
 					//check if light is visible
-					if (!m_scene->any_intersection(light_ray, light_distance - RAY_EPSILON))
+					if (m_scene->is_light_visible(light_index, cur_ray.origin, RAY_EPSILON))
 					{
 						// PointLight source is visible -> add segment from light to hit_pos
 						PathSegment path_segment(cur_ray.origin, light->pos, glm::vec3(0.1f), light->intensity);
@@ -145,7 +274,7 @@ void Pathtracer::sample(const Ray& _ray)
 	//Camera ray did not hit anything
 	if (path_segments.size() == 0)
 	{
-		return;
+		return false;
 	}
 
 	//first path segment has no incoming flux
@@ -164,37 +293,211 @@ void Pathtracer::sample(const Ray& _ray)
 		float biasCorrection = glm::clamp(glm::length(dir) / glm::max(glm::abs(dir.x), glm::abs(dir.y)), 1.0f, 1.414214f);
 
 		//add to vector
-		draw_data.push_back(DrawData(start_point, end_point, ray_start_flux * biasCorrection));
+		_out.push_back(DrawData(start_point, end_point, ray_start_flux * biasCorrection));
 
 		float distance = glm::distance((*segment_it).destination, (*segment_it).origin);
 		distance = std::max(distance, 1.0f);
 		//the incoming flux for the next point
 		incoming_flux /= distance;
 	}
+	return true;
+}
 
+void Pathtracer::finish()
+{
+	if (wavefront->size() > 0)
+	{
+		trace_wave();
+	}
 
-	//draw all collected path segments and clear vector
-	if (draw_data.size() >= 1024)
+	for (auto& worker : workers)
+	{
+		num_iterations += worker->num_samples;
+		worker->num_samples = 0;
+	}
+
+	//the workers queued all their lines in finish(worker), draw them once for the whole exposure
+	submit_draw_data(draw_data, true);
+	drain_draw_data();
+}
+
+void Pathtracer::trace_wave()
+{
+	num_iterations += static_cast<int>(wavefront->trace(*m_scene, settings, draw_data));
+	submit_draw_data(draw_data, false);
+}
+
+void Pathtracer::submit_draw_data(std::vector<DrawData>& _staging, bool _force, uint32_t _splat_set)
+{
+	if (_staging.size() < DRAW_BLOCK_SIZE && (!_force || _staging.empty()))
+	{
+		return;
+	}
+
+	if (settings.splat_backend == SplatBackend::CPU || !gl_target)
+	{
+		//no queue, every thread splats into its own tiles
+		splatter->splat(_splat_set, _staging, m_scene->get_size());
+		_staging.clear();
+		splatter_changed.store(true, std::memory_order_relaxed);
+		return;
+	}
+
+	DrawBlock block;
+	if (settings.packed_draw_data)
+	{
+		//the staging block keeps its memory, only the packed lines are queued
+		block.packed_lines.reserve(_staging.size());
+		const glm::vec2 scene_size = m_scene->get_size();
+		for (const DrawData& data : _staging)
+		{
+			block.packed_lines.emplace_back(data, scene_size);
+		}
+		_staging.clear();
+	}
+	else
+	{
+		block.lines = std::move(_staging);
+		_staging = std::vector<DrawData>();
+		_staging.reserve(DRAW_BLOCK_SIZE);
+	}
+
+	//backpressure: a full queue stalls the tracing threads until the GL thread has drawn it
+	while (!draw_queue.try_push(block))
+	{
+		if (std::this_thread::get_id() == gl_thread)
+		{
+			drain_draw_data();
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void Pathtracer::drain_draw_data()
+{
+	//draw all queued blocks with a single upload (per format, the setting can change while blocks are queued)
+	std::vector<DrawData> lines;
+	std::vector<PackedDrawData> packed_lines;
+	DrawBlock block;
+	while (draw_queue.try_pop(block))
+	{
+		if (lines.empty())
+		{
+			lines = std::move(block.lines);
+		}
+		else
+		{
+			lines.insert(lines.end(), block.lines.begin(), block.lines.end());
+		}
+		packed_lines.insert(packed_lines.end(), block.packed_lines.begin(), block.packed_lines.end());
+	}
+	if (gl_target && (!lines.empty() || !packed_lines.empty()))
 	{
 		//draw lines on samples texture
-		render_path(path_program, samples_framebuffer, add_samples_pipeline, *m_scene, draw_data);
-		draw_data.clear();
+		gl_target->path_renderer->render(gl_target->path_program, gl_target->samples_framebuffer, gl_target->add_samples_pipeline,
+		                                 *m_scene, lines, packed_lines);
 	}
+}
 
-	num_iterations++;
+/// shared exponent encoding of a non-negative color (EXT_texture_shared_exponent), the shader decodes it
+static uint32_t encode_rgb9e5(const glm::vec3& _rgb)
+{
+	constexpr int MANTISSA_BITS = 9;
+	constexpr int EXP_BIAS = 15;
+	//largest value: (2^9 - 1) / 2^9 * 2^(31 - 15)
+	constexpr float MAX_VALUE = 511.0f / 512.0f * 65536.0f;
+
+	const glm::vec3 rgb = glm::clamp(_rgb, glm::vec3(0.0f), glm::vec3(MAX_VALUE));
+	const float max_component = std::max(rgb.r, std::max(rgb.g, rgb.b));
+	if (!(max_component > 0.0f))
+	{
+		return 0;
+	}
+
+	//max_component = m * 2^e with m in [0.5, 1), so floor(log2(max_component)) = e - 1
+	int e = 0;
+	std::frexp(max_component, &e);
+	int exponent = std::max(0, e + EXP_BIAS);
+	float scale = std::ldexp(1.0f, exponent - EXP_BIAS - MANTISSA_BITS);
+	//rounding can overflow the mantissa
+	if (std::floor(max_component / scale + 0.5f) >= float(1 << MANTISSA_BITS))
+	{
+		scale *= 2.0f;
+		++exponent;
+	}
+	const glm::uvec3 mantissa(glm::floor(rgb / scale + 0.5f));
+	return mantissa.r | mantissa.g << 9 | mantissa.b << 18 | uint32_t(exponent) << 27;
+}
+
+PackedDrawData::PackedDrawData(const DrawData& _data, glm::vec2 _scene_size)
+{
+	//[-0.5, 1.5] * scene size to [0, 65535]
+	const glm::vec2 scale = 65535.0f / (2.0f * glm::max(_scene_size, glm::vec2(1e-6f)));
+	const auto quantize = [&](const glm::vec2& p)
+	{
+		return glm::clamp(glm::floor((p + 0.5f * _scene_size) * scale + 0.5f), glm::vec2(0.0f), glm::vec2(65535.0f));
+	};
+	const glm::vec2 start = quantize(_data.start_point);
+	const glm::vec2 end = quantize(_data.end_point);
+	points[0] = uint16_t(start.x);
+	points[1] = uint16_t(start.y);
+	points[2] = uint16_t(end.x);
+	points[3] = uint16_t(end.y);
+	start_flux = encode_rgb9e5(_data.start_flux);
+}
+
+void Pathtracer::expose(int _num_iterations, ThreadPool& _pool)
+{
+	const Camera& camera = *m_scene->get_camera();
+	const SampleGenerator sampler(settings.sampler);
+	const uint32_t first_sample = camera_sample;
+	camera_sample += static_cast<uint32_t>(_num_iterations);
+	if (settings.parallel)
+	{
+		camera.expose(*this, sampler, first_sample, _num_iterations, _pool, settings.chunk_size);
+	}
+	else
+	{
+		camera.expose(*this, sampler, first_sample, _num_iterations);
+	}
 }
 
 void Pathtracer::draw_result(gpupro::Program& compose_program)
 {
+	gpupro::Texture& samples_tex = gl_target->samples_tex;
+	//all threads are done with their tiles here
+	if (splatter_changed.exchange(false))
+	{
+		std::vector<float> image;
+		splatter->resolve(image);
+		samples_tex.setData(gpupro::SetDataFormat::RGB, gpupro::SetDataType::FLOAT, image.data());
+	}
 	render_result(samples_tex, num_iterations, settings.exposure, compose_program);
 }
 
+void Pathtracer::read_result(std::vector<float>& _rgb) const
+{
+	splatter->resolve(_rgb);
+	const float scale = settings.exposure / static_cast<float>(std::max(num_iterations, 1));
+	for (float& value : _rgb)
+	{
+		value *= scale;
+	}
+}
+
 void Pathtracer::reset()
 {
 	num_iterations = 0;
-	int size = samples_tex.getHeight() * samples_tex.getWidth();
-	std::vector<glm::vec4> data(size, glm::vec4(0.0f));
-	//clear samples texture to 0
-	GLfloat clearColor[3] = { 0.0f, 0.0f, 0.0f };
-	glClearTexImage(samples_tex.getID(), 0, GL_RGB, GL_FLOAT, clearColor);
+	camera_sample = 0;
+	if (gl_target)
+	{
+		//clear samples texture to 0
+		GLfloat clearColor[3] = { 0.0f, 0.0f, 0.0f };
+		glClearTexImage(gl_target->samples_tex.getID(), 0, GL_RGB, GL_FLOAT, clearColor);
+	}
+	splatter->clear();
+	splatter_changed.store(false);
 }
@@ -1,9 +1,28 @@
 #pragma once
 
 #include "raysampler.h"
+#include "../scene/scene.hpp"
+#include "../utils/sampler.hpp"
+#include "../utils/mpsc_queue.hpp"
+#include <atomic>
+#include <thread>
 #include "../../shared/framework/framework.h"
 
 struct DrawData;
+struct PackedDrawData;
+class WavefrontIntegrator;
+class PathRenderer;
+class SoftwareSplatter;
+class ThreadPool;
+
+// where the lines are accumulated
+enum class SplatBackend
+{
+	// line rasterization with additive blending into the samples texture
+	GL,
+	// SoftwareSplatter, every tracing thread splats into its own tiles
+	CPU
+};
 
 struct PathtracerSettings
 {
@@ -12,19 +31,60 @@ struct PathtracerSettings
 	bool direct_light_ray = false;
 	float exposure = 1.0f;
 	bool timelapse = false;
+	//light selection for next event estimation
+	LightSampling light_sampling = LightSampling::ALL;
+	//number of lights sampled per vertex if light_sampling is not ALL
+	int light_samples = 1;
+	//trace the camera rays in waves (WavefrontIntegrator) instead of one path after the other
+	bool wavefront = false;
+	//expose on all cores (Camera::expose with a thread pool)
+	bool parallel = true;
+	//workers of the thread pool including the main thread, 0 = one per hardware thread
+	uint32_t num_workers = 0;
+	//strata per task of a parallel exposure, small chunks balance better but steal more often
+	int chunk_size = Camera::DEFAULT_CHUNK_SIZE;
+	//random numbers of the camera jitter, the light selection and the materials
+	SamplerType sampler = SamplerType::RANDOM;
+	//queue and upload the lines as PackedDrawData (12 instead of 28 bytes per line)
+	bool packed_draw_data = false;
+	//accumulate the lines with GL or on the CPU
+	SplatBackend splat_backend = SplatBackend::GL;
 };
 
 class Pathtracer : public RaySampler
 {
 public:
 	Pathtracer(int width, int height, const gpupro::Program& path_program);
+	/// \brief Pathtracer without a GL context (batch rendering)
+	///
+	/// The lines are always accumulated with SplatBackend::CPU, draw_result must not be called.
+	Pathtracer(int width, int height);
+	~Pathtracer() override;
+
+	void sample_packet(const RayPacket& packet) override;
+	void finish() override;
 
-	void sample(const Ray& ray) override;
+	void prepare_workers(uint32_t num_workers) override;
+	void sample_packet(const RayPacket& packet, uint32_t worker) override;
+	void finish(uint32_t worker) override;
+	void idle() override;
+
+	/// \brief traces num_iterations camera iterations of the current scene, on the pool if settings.parallel is set
+	///
+	/// The sample index of the camera iterations is kept here and not in the camera, which is shared by all scene versions.
+	void expose(int num_iterations, ThreadPool& pool);
 
 	void draw_result(gpupro::Program& compose_program);
 
+	/// \brief the image of SplatBackend::CPU like the compose shader sees it before the gamma correction
+	/// \param [out] _rgb width * height linear RGB values (sum / num_iterations * exposure), the first row is the bottom one
+	void read_result(std::vector<float>& rgb) const;
+
+	/// number of traced camera paths
+	int get_num_iterations() const { return num_iterations; }
+
 	/// <summary>
-	/// clears samples texture and num_iterations to 0
+	/// clears samples texture, num_iterations and the camera sample index to 0
 	/// </summary>
 	void reset();
 
@@ -32,17 +92,84 @@ public:
 	PathtracerSettings settings;
 
 private:
-	//RGB32F texture where the lines are drawn
-	gpupro::Texture samples_tex;
-	gpupro::Framebuffer samples_framebuffer;
-	//use additive blending
-	gpupro::Pipeline add_samples_pipeline;
-	//Shader to draw the paths
-	const gpupro::Program& path_program;
+	/// mutable state of one worker of a parallel exposure
+	struct Worker
+	{
+		Worker();
+		~Worker();
+
+		//block that is filled before it is handed to the GL thread
+		std::vector<DrawData> draw_data;
+		int num_samples = 0;
+		std::unique_ptr<WavefrontIntegrator> wavefront;
+	};
+
+	/// traces a camera path whose first hit is already known and collects its segments
+	/// \param [in] stratum, sample index of the random numbers of the path (see SampleGenerator)
+	/// \param [out] out the segments of the path are appended here
+	/// \return false if the camera ray did not hit anything, such a path has no segments and is not counted as a sample
+	bool trace_path(const Ray& ray, bool first_hit, const Intersection& first_isect, uint32_t stratum, uint32_t sample,
+	                std::vector<DrawData>& out);
+	/// first hits of the whole packet together, then trace_path for every ray with the random numbers of its stratum and sample
+	/// \return number of paths with segments
+	int trace_packet(const RayPacket& packet, std::vector<DrawData>& out);
+	/// traces the queued wave of the wavefront integrator
+	void trace_wave();
+	/// lines in the draw queue, one of the two is used (see PathtracerSettings::packed_draw_data)
+	struct DrawBlock
+	{
+		std::vector<DrawData> lines;
+		std::vector<PackedDrawData> packed_lines;
+	};
+
+	/// hands a block of segments to the GL thread once it is full.
+	/// Waits while the queue is full (the GL thread draws the queue itself instead).
+	/// \param [in,out] staging the block, empty after it was queued
+	/// \param [in] force also queue a block that is not full yet
+	/// \param [in] splat_set tile set of the calling thread for SplatBackend::CPU (the worker index)
+	void submit_draw_data(std::vector<DrawData>& staging, bool force, uint32_t splat_set = 0);
+	/// draws all queued blocks, GL thread only
+	void drain_draw_data();
+
+	/// everything that needs a GL context
+	struct GLTarget
+	{
+		GLTarget(int width, int height, const gpupro::Program& path_program);
+
+		//RGB32F texture where the lines are drawn
+		gpupro::Texture samples_tex;
+		gpupro::Framebuffer samples_framebuffer;
+		//use additive blending
+		gpupro::Pipeline add_samples_pipeline;
+		//Shader to draw the paths
+		const gpupro::Program& path_program;
+		//vertex array, uniform and vertex ring buffer for the lines
+		std::unique_ptr<PathRenderer> path_renderer;
+	};
+
+	//null for a headless pathtracer
+	std::unique_ptr<GLTarget> gl_target;
+	//accumulation for SplatBackend::CPU, copied into samples_tex before it is drawn
+	std::unique_ptr<SoftwareSplatter> splatter;
+	std::atomic<bool> splatter_changed{ false };
 	int num_iterations;
+	//sample index of the next camera iteration (random numbers of the jitter and the paths)
+	uint32_t camera_sample = 0;
 
 	//collect lines to draw 
 	std::vector<DrawData> draw_data;
+	//full blocks of lines from all tracing threads, drawn once per exposure (or earlier if it gets full)
+	MPSCQueue<DrawBlock> draw_queue;
+	//the only thread that talks to GL
+	std::thread::id gl_thread;
+
+	std::unique_ptr<WavefrontIntegrator> wavefront;
+	std::vector<std::unique_ptr<Worker>> workers;
+	//camera rays per wave
+	static constexpr size_t WAVE_SIZE = 4096;
+	//lines per block of draw_queue
+	static constexpr size_t DRAW_BLOCK_SIZE = 1024;
+	static constexpr size_t DRAW_QUEUE_BLOCKS = 256;
 
 	const float RAY_EPSILON = 1e-2f;
 };
@@ -80,3 +207,16 @@ struct DrawData
 	glm::vec2 end_point;
 	glm::vec3 start_flux;
 };
+
+// DrawData in 12 bytes, decoded by the path vertex shader
+struct PackedDrawData
+{
+	PackedDrawData() = default;
+	/// \param [in] _scene_size the points are stored relative to it
+	PackedDrawData(const DrawData& _data, glm::vec2 _scene_size);
+
+	/// start and end point, 16 bit fixed point in [-0.5, 1.5] * scene size (lines may leave the scene a bit)
+	uint16_t points[4];
+	/// start flux as RGB9E5 (9 bit mantissas with a shared 5 bit exponent)
+	uint32_t start_flux;
+};
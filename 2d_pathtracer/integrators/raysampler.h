@@ -2,9 +2,10 @@
 
 #include <iostream>
 #include <memory>
+#include <mutex>
 
+#include "../geometry/ray_packet.hpp"
 
-class Ray;
 class Scene;
 
 class RaySampler
@@ -12,13 +13,40 @@ class RaySampler
 public:
 	virtual ~RaySampler() = default;
 
-	void set_scene(std::shared_ptr<Scene> scene)
+	/// the sampler keeps the scene version alive until the next call
+	void set_scene(std::shared_ptr<const Scene> scene)
 	{
 		m_scene = scene;
 	}
 
-	virtual void sample(const Ray& ray)  = 0;
+	/// samples neighbouring camera rays. The packet carries the stratum of every ray and the sample index,
+	/// the random numbers of a path are indexed by them (see SampleGenerator).
+	virtual void sample_packet(const RayPacket& packet) = 0;
+
+	/// called after the last ray of an exposure, samplers that collect rays trace the rest here
+	virtual void finish() {}
+
+	/// called before a parallel exposure with the number of workers of the thread pool
+	virtual void prepare_workers(uint32_t num_workers) {}
+
+	/// sample_packet for parallel exposures, called from several threads at once.
+	/// A worker index is only used by one thread at a time, samplers keep their mutable state per worker.
+	/// The default implementation serializes the calls.
+	virtual void sample_packet(const RayPacket& packet, uint32_t worker)
+	{
+		std::lock_guard<std::mutex> lock(m_worker_mutex);
+		sample_packet(packet);
+	}
+
+	/// called once per worker index after all packets of a parallel exposure, in parallel for different workers
+	virtual void finish(uint32_t worker) {}
+
+	/// called on the thread that started a parallel exposure while it waits for the other workers
+	virtual void idle() {}
 
 protected:
-	std::shared_ptr<Scene> m_scene;
+	std::shared_ptr<const Scene> m_scene;
+
+private:
+	std::mutex m_worker_mutex;
 };
@@ -0,0 +1,244 @@
+#include "software_splatter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "pathtracer.hpp"
+#include "../utils/simd.hpp"
+
+SoftwareSplatter::SoftwareSplatter(int _width, int _height) :
+	width(_width), height(_height),
+	tiles_x((_width + TILE_SIZE - 1) / TILE_SIZE), tiles_y((_height + TILE_SIZE - 1) / TILE_SIZE)
+{
+	prepare_threads(1);
+}
+
+SoftwareSplatter::~SoftwareSplatter() = default;
+
+void SoftwareSplatter::prepare_threads(uint32_t _num_threads)
+{
+	while (sets.size() < _num_threads)
+	{
+		auto set = std::make_unique<TileSet>();
+		set->tiles.resize(tiles_x * tiles_y);
+		set->bins.resize(tiles_x * tiles_y);
+		sets.push_back(std::move(set));
+	}
+}
+
+void SoftwareSplatter::splat(uint32_t _thread, const std::vector<DrawData>& _lines, glm::vec2 _scene_size)
+{
+	if (_scene_size.x <= 0.0f || _scene_size.y <= 0.0f)
+	{
+		return;
+	}
+	TileSet& set = *sets[_thread];
+	const glm::vec2 pixels_per_unit = glm::vec2(width, height) / _scene_size;
+
+	//bin the whole block first
+	set.lines.clear();
+	for (const DrawData& data : _lines)
+	{
+		PixelLine line;
+		if (setup_line(data, pixels_per_unit, line))
+		{
+			bin_line(line, static_cast<uint32_t>(set.lines.size()), set);
+			set.lines.push_back(line);
+		}
+	}
+
+	//then one tile after the other
+	for (uint32_t tile_index : set.used_bins)
+	{
+		std::unique_ptr<Tile>& tile = set.tiles[tile_index];
+		if (!tile)
+		{
+			tile = std::make_unique<Tile>();
+		}
+		const int tile_x = static_cast<int>(tile_index) % tiles_x;
+		const int tile_y = static_cast<int>(tile_index) / tiles_x;
+		for (uint32_t line : set.bins[tile_index])
+		{
+			rasterize(set.lines[line], tile_x, tile_y, *tile);
+		}
+		set.bins[tile_index].clear();
+	}
+	set.used_bins.clear();
+}
+
+bool SoftwareSplatter::setup_line(const DrawData& _data, glm::vec2 _pixels_per_unit, PixelLine& _line) const
+{
+	if (_data.start_flux == glm::vec3(0.0f))
+	{
+		return false;
+	}
+	const glm::vec2 p0 = _data.start_point * _pixels_per_unit;
+	const glm::vec2 dir = _data.end_point * _pixels_per_unit - p0;
+
+	_line.x_major = std::abs(dir.x) >= std::abs(dir.y);
+	_line.major0 = _line.x_major ? p0.x : p0.y;
+	_line.minor0 = _line.x_major ? p0.y : p0.x;
+	_line.major_dir = _line.x_major ? dir.x : dir.y;
+	_line.minor_dir = _line.x_major ? dir.y : dir.x;
+	//like GL, a line without extent has no fragments
+	if (!(_line.major_dir != 0.0f))
+	{
+		return false;
+	}
+	_line.slope = _line.minor_dir / _line.major_dir;
+	_line.inv_length2 = 1.0f / glm::dot(dir, dir);
+	_line.scene_length = glm::distance(_data.start_point, _data.end_point);
+	_line.flux = _data.start_flux;
+
+	//pixels whose center along the major axis lies in [lo, hi)
+	const int major_size = _line.x_major ? width : height;
+	const int minor_size = _line.x_major ? height : width;
+	const float lo = std::min(_line.major0, _line.major0 + _line.major_dir);
+	const float hi = std::max(_line.major0, _line.major0 + _line.major_dir);
+	_line.first = std::max(0, static_cast<int>(std::ceil(std::max(lo - 0.5f, -1.0f))));
+	_line.last = std::min(major_size, static_cast<int>(std::ceil(std::min(hi - 0.5f, float(major_size)))));
+
+	const float minor_lo = std::min(_line.minor0, _line.minor0 + _line.minor_dir);
+	const float minor_hi = std::max(_line.minor0, _line.minor0 + _line.minor_dir);
+	return _line.first < _line.last && minor_hi >= 0.0f && minor_lo < float(minor_size);
+}
+
+void SoftwareSplatter::bin_line(const PixelLine& _line, uint32_t _index, TileSet& _set) const
+{
+	const int minor_size = _line.x_major ? height : width;
+	const int major_tiles = _line.x_major ? tiles_x : tiles_y;
+	const auto minor_at = [&](int major)
+	{
+		return static_cast<int>(std::floor(_line.minor0 + (float(major) + 0.5f - _line.major0) * _line.slope));
+	};
+
+	for (int tile_major = _line.first / TILE_SIZE; tile_major <= (_line.last - 1) / TILE_SIZE && tile_major < major_tiles; ++tile_major)
+	{
+		const int begin = std::max(_line.first, tile_major * TILE_SIZE);
+		const int end = std::min(_line.last, (tile_major + 1) * TILE_SIZE);
+		//the minor coordinate is monotonic along the line, one pixel of margin against rounding
+		const int a = minor_at(begin);
+		const int b = minor_at(end - 1);
+		const int minor_begin = std::max(0, std::min(a, b) - 1);
+		const int minor_end = std::min(minor_size - 1, std::max(a, b) + 1);
+		if (minor_begin > minor_end)
+		{
+			continue;
+		}
+		for (int tile_minor = minor_begin / TILE_SIZE; tile_minor <= minor_end / TILE_SIZE; ++tile_minor)
+		{
+			const uint32_t tile_index = _line.x_major ? tile_minor * tiles_x + tile_major : tile_major * tiles_x + tile_minor;
+			std::vector<uint32_t>& bin = _set.bins[tile_index];
+			if (bin.empty())
+			{
+				_set.used_bins.push_back(tile_index);
+			}
+			bin.push_back(_index);
+		}
+	}
+}
+
+void SoftwareSplatter::rasterize(const PixelLine& _line, int _tile_x, int _tile_y, Tile& _tile) const
+{
+	using simd::vfloat;
+
+	//tile origin and pixel strides along the axes of the line
+	const int major_origin = (_line.x_major ? _tile_x : _tile_y) * TILE_SIZE;
+	const int minor_origin = (_line.x_major ? _tile_y : _tile_x) * TILE_SIZE;
+	const int major_stride = _line.x_major ? 1 : TILE_SIZE;
+	const int minor_stride = _line.x_major ? TILE_SIZE : 1;
+	const int minor_size = _line.x_major ? height : width;
+	const int minor_end = std::min(minor_origin + TILE_SIZE, minor_size);
+
+	const int begin = std::max(_line.first, major_origin);
+	const int end = std::min(_line.last, major_origin + TILE_SIZE);
+
+	alignas(32) float lane_centers[simd::WIDTH];
+	for (int i = 0; i < simd::WIDTH; ++i)
+	{
+		lane_centers[i] = float(i) + 0.5f;
+	}
+	const vfloat centers = vfloat::load(lane_centers);
+	const vfloat major0 = vfloat::broadcast(_line.major0);
+	const vfloat minor0 = vfloat::broadcast(_line.minor0);
+	const vfloat slope = vfloat::broadcast(_line.slope);
+	const vfloat major_dir = vfloat::broadcast(_line.major_dir);
+	const vfloat minor_dir = vfloat::broadcast(_line.minor_dir);
+	const vfloat inv_length2 = vfloat::broadcast(_line.inv_length2);
+	const vfloat scene_length = vfloat::broadcast(_line.scene_length);
+	const vfloat zero = vfloat::broadcast(0.0f);
+	const vfloat half = vfloat::broadcast(0.5f);
+	const vfloat one = vfloat::broadcast(1.0f);
+
+	//a span of WIDTH fragments along the major axis at once
+	for (int major = begin; major < end; major += simd::WIDTH)
+	{
+		const vfloat along = vfloat::broadcast(float(major)) + centers - major0;
+		const vfloat minor = simd::floor(minor0 + along * slope);
+		//the fragment center projected onto the line, like GL interpolates the varyings
+		vfloat t = (along * major_dir + (minor + half - minor0) * minor_dir) * inv_length2;
+		t = simd::min(simd::max(t, zero), one);
+		//path_fragment.glsl: flux / max(d, 1), d is the distance to the end point (the flat start_position)
+		const vfloat weight = one / simd::max((one - t) * scene_length, one);
+
+		alignas(32) float minors[simd::WIDTH];
+		alignas(32) float weights[simd::WIDTH];
+		simd::store(minor, minors);
+		simd::store(weight, weights);
+		const int count = std::min(simd::WIDTH, end - major);
+		for (int i = 0; i < count; ++i)
+		{
+			const int m = static_cast<int>(minors[i]);
+			if (m < minor_origin || m >= minor_end)
+			{
+				continue;
+			}
+			const int index = (major + i - major_origin) * major_stride + (m - minor_origin) * minor_stride;
+			_tile.r[index] += _line.flux.r * weights[i];
+			_tile.g[index] += _line.flux.g * weights[i];
+			_tile.b[index] += _line.flux.b * weights[i];
+		}
+	}
+}
+
+void SoftwareSplatter::resolve(std::vector<float>& _rgb) const
+{
+	_rgb.assign(static_cast<size_t>(width) * height * 3, 0.0f);
+	for (int tile_y = 0; tile_y < tiles_y; ++tile_y)
+	{
+		for (int tile_x = 0; tile_x < tiles_x; ++tile_x)
+		{
+			const int x_end = std::min(TILE_SIZE, width - tile_x * TILE_SIZE);
+			const int y_end = std::min(TILE_SIZE, height - tile_y * TILE_SIZE);
+			for (const auto& set : sets)
+			{
+				const Tile* tile = set->tiles[tile_y * tiles_x + tile_x].get();
+				if (!tile)
+				{
+					continue;
+				}
+				for (int y = 0; y < y_end; ++y)
+				{
+					float* row = &_rgb[(static_cast<size_t>(tile_y * TILE_SIZE + y) * width + tile_x * TILE_SIZE) * 3];
+					for (int x = 0; x < x_end; ++x)
+					{
+						row[3 * x] += tile->r[y * TILE_SIZE + x];
+						row[3 * x + 1] += tile->g[y * TILE_SIZE + x];
+						row[3 * x + 2] += tile->b[y * TILE_SIZE + x];
+					}
+				}
+			}
+		}
+	}
+}
+
+void SoftwareSplatter::clear()
+{
+	for (auto& set : sets)
+	{
+		for (auto& tile : set->tiles)
+		{
+			tile.reset();
+		}
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct DrawData;
+
+///
+/// \brief Accumulates the path segments on the CPU, no GL context needed
+///
+/// Produces the same image as drawing the lines into the samples texture: one fragment per pixel along the major
+/// axis of a line, weighted with the 1/d falloff of path_fragment.glsl (the bias correction for diagonal lines is
+/// already part of DrawData::start_flux). The image is split into tiles and every thread splats into its own set
+/// of tiles, so the tracing threads never wait for each other. A block of lines is binned per tile first, then
+/// every tile is rasterized on its own while it is in cache.
+class SoftwareSplatter
+{
+public:
+	SoftwareSplatter(int width, int height);
+	~SoftwareSplatter();
+
+	/// make sure there is a tile set for every thread in [0, num_threads)
+	void prepare_threads(uint32_t num_threads);
+
+	/// add the lines to the tile set of one thread, other threads may splat into their own sets at the same time
+	/// \param [in] _thread index of the tile set
+	/// \param [in] _lines lines in scene coordinates
+	/// \param [in] _scene_size the scene is mapped onto the whole image
+	void splat(uint32_t thread, const std::vector<DrawData>& lines, glm::vec2 scene_size);
+
+	/// sum of all tile sets, no thread may splat meanwhile
+	/// \param [out] _rgb width * height RGB values, the first row is the bottom one (like the samples texture)
+	void resolve(std::vector<float>& rgb) const;
+
+	/// set the image to 0
+	void clear();
+
+	int get_width() const { return width; }
+	int get_height() const { return height; }
+
+private:
+	static constexpr int TILE_SIZE = 32;
+
+	/// planar color channels of TILE_SIZE * TILE_SIZE pixels
+	struct Tile
+	{
+		float r[TILE_SIZE * TILE_SIZE];
+		float g[TILE_SIZE * TILE_SIZE];
+		float b[TILE_SIZE * TILE_SIZE];
+	};
+
+	/// a line in pixel coordinates, described along its major axis
+	struct PixelLine
+	{
+		//the major axis is x
+		bool x_major;
+		//start point and direction along the major and the minor axis
+		float major0, minor0;
+		float major_dir, minor_dir;
+		//minor_dir / major_dir
+		float slope;
+		//1 / squared length in pixels
+		float inv_length2;
+		//length in scene units, for the falloff
+		float scene_length;
+		//fragments along the major axis [first, last)
+		int first, last;
+		glm::vec3 flux;
+	};
+
+	struct TileSet
+	{
+		//allocated when a line touches the tile first
+		std::vector<std::unique_ptr<Tile>> tiles;
+		//lines of the current block per tile
+		std::vector<std::vector<uint32_t>> bins;
+		//tiles with a non-empty bin
+		std::vector<uint32_t> used_bins;
+		std::vector<PixelLine> lines;
+	};
+
+	/// \return false if the line has no fragment in the image
+	bool setup_line(const DrawData& data, glm::vec2 pixels_per_unit, PixelLine& line) const;
+	/// adds the line to the bins of all tiles it may have fragments in
+	void bin_line(const PixelLine& line, uint32_t index, TileSet& set) const;
+	/// adds the fragments of the line that lie in the tile
+	void rasterize(const PixelLine& line, int tile_x, int tile_y, Tile& tile) const;
+
+	int width;
+	int height;
+	int tiles_x;
+	int tiles_y;
+	std::vector<std::unique_ptr<TileSet>> sets;
+};
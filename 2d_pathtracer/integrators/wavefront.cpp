@@ -0,0 +1,326 @@
+#include "wavefront.hpp"
+
+#include <algorithm>
+#include <typeinfo>
+
+#include "../scene/scene.hpp"
+#include "../scene/light.hpp"
+#include "../materials/material.hpp"
+#include "../geometry/intersections.hpp"
+#include "../geometry/ray.hpp"
+#include "../utils/sampler.hpp"
+
+void WavefrontIntegrator::RayQueue::clear()
+{
+	origin_x.clear();
+	origin_y.clear();
+	dir_x.clear();
+	dir_y.clear();
+	path.clear();
+}
+
+void WavefrontIntegrator::RayQueue::push(glm::vec2 _origin, glm::vec2 _dir, uint32_t _path)
+{
+	origin_x.push_back(_origin.x);
+	origin_y.push_back(_origin.y);
+	dir_x.push_back(_dir.x);
+	dir_y.push_back(_dir.y);
+	path.push_back(_path);
+}
+
+void WavefrontIntegrator::HitQueue::clear()
+{
+	ray.clear();
+	t.clear();
+	normal_x.clear();
+	normal_y.clear();
+	material_id.clear();
+	illumination.clear();
+}
+
+void WavefrontIntegrator::ShadowQueue::clear()
+{
+	point_x.clear();
+	point_y.clear();
+	light.clear();
+	contribution.clear();
+	hit.clear();
+	path.clear();
+}
+
+void WavefrontIntegrator::add_camera_rays(const RayPacket& _packet)
+{
+	m_camera_packets.push_back(_packet);
+	m_num_paths += _packet.count;
+}
+
+size_t WavefrontIntegrator::trace(const Scene& _scene, const PathtracerSettings& _settings, std::vector<DrawData>& _draw_data)
+{
+	m_rays.clear();
+	m_path_stratum.clear();
+	m_path_sample.clear();
+	for (const auto& packet : m_camera_packets)
+	{
+		for (uint32_t k = 0; k < packet.count; ++k)
+		{
+			m_rays.push(packet.origin, packet.directions[k], static_cast<uint32_t>(m_rays.size()));
+			m_path_stratum.push_back(packet.first_stratum + k);
+			m_path_sample.push_back(packet.sample);
+		}
+	}
+	m_segments.clear();
+	m_segment_path.clear();
+
+	size_t num_hit_paths = 0;
+	for (int bounce = 0; bounce < _settings.path_length && m_rays.size() > 0; ++bounce)
+	{
+		extend(_scene, _settings, bounce);
+		if (bounce == 0)
+		{
+			//paths without a first hit have no segments
+			num_hit_paths = m_hits.size();
+		}
+		shadow(_scene, _settings, bounce);
+		shade(_scene, _settings, bounce);
+		std::swap(m_rays, m_next_rays);
+	}
+
+	splat(_draw_data);
+	m_camera_packets.clear();
+	m_num_paths = 0;
+	return num_hit_paths;
+}
+
+void WavefrontIntegrator::extend(const Scene& _scene, const PathtracerSettings& _settings, int _bounce)
+{
+	m_hits.clear();
+	m_escaped.clear();
+
+	const auto push_hit = [this](uint32_t ray, const Intersection& isect)
+	{
+		m_hits.ray.push_back(ray);
+		m_hits.t.push_back(isect.t_max);
+		m_hits.normal_x.push_back(isect.normal.x);
+		m_hits.normal_y.push_back(isect.normal.y);
+		m_hits.material_id.push_back(isect.material_id);
+	};
+
+	if (_bounce == 0)
+	{
+		//camera rays are traced as the packets they were generated in, the ray queue has the same order
+		uint32_t first = 0;
+		for (const auto& packet : m_camera_packets)
+		{
+			Intersection isects[RayPacket::MAX_SIZE];
+			bool hits[RayPacket::MAX_SIZE];
+			_scene.first_camera_intersections(packet, isects, hits);
+			for (uint32_t k = 0; k < packet.count; ++k)
+			{
+				if (hits[k])
+				{
+					push_hit(first + k, isects[k]);
+				}
+			}
+			first += packet.count;
+		}
+	}
+	else
+	{
+		for (uint32_t i = 0; i < m_rays.size(); ++i)
+		{
+			Intersection isect;
+			if (_scene.first_intersection(Ray(m_rays.origin(i), m_rays.dir(i)), isect))
+			{
+				push_hit(i, isect);
+			}
+			else if (_settings.direct_light_ray)
+			{
+				//every ray after the first bounce belongs to a path with a hit
+				m_escaped.push(m_rays.origin(i), m_rays.dir(i), m_rays.path[i]);
+			}
+		}
+	}
+	m_hits.illumination.assign(m_hits.size(), glm::vec3(0.0f));
+}
+
+void WavefrontIntegrator::shadow(const Scene& _scene, const PathtracerSettings& _settings, int _bounce)
+{
+	m_shadow.clear();
+	const SampleGenerator sampler(_settings.sampler);
+	const auto& lights = _scene.getLights();
+
+	//queue one visibility test per selected light and hit
+	for (uint32_t h = 0; h < m_hits.size(); ++h)
+	{
+		const uint32_t ray = m_hits.ray[h];
+		const glm::vec2 dir = m_rays.dir(ray);
+		const glm::vec2 hit_pos = m_rays.origin(ray) + dir * m_hits.t[h];
+		const glm::vec2 normal(m_hits.normal_x[h], m_hits.normal_y[h]);
+		const glm::vec2 point = hit_pos - RAY_EPSILON * dir;
+
+		const auto queue_light = [&](uint32_t light_index, float weight)
+		{
+			const auto& light = lights[light_index];
+			glm::vec2 light_dir = light->pos - hit_pos;
+			const float light_distance = glm::length(light_dir);
+			light_dir /= light_distance;
+			const float cosE = abs(glm::dot(light_dir, normal));
+			m_shadow.point_x.push_back(point.x);
+			m_shadow.point_y.push_back(point.y);
+			m_shadow.light.push_back(light_index);
+			m_shadow.contribution.push_back(light->intensity * cosE / glm::max(1.0f, light_distance) * weight);
+			m_shadow.hit.push_back(h);
+			m_shadow.path.push_back(m_rays.path[ray]);
+		};
+
+		if (_settings.light_sampling == LightSampling::ALL)
+		{
+			for (uint32_t light_index = 0; light_index < lights.size(); ++light_index)
+			{
+				queue_light(light_index, 1.0f);
+			}
+		}
+		else if (!lights.empty())
+		{
+			const uint32_t path = m_rays.path[ray];
+			const int num_samples = std::max(1, _settings.light_samples);
+			for (int s = 0; s < num_samples; ++s)
+			{
+				float light_pdf = 1.0f;
+				const float xi = sampler.get(m_path_stratum[path], m_path_sample[path], SampleGenerator::light_dimension(_bounce, s));
+				const uint32_t light_index = _scene.sample_light(_settings.light_sampling, hit_pos, xi, light_pdf);
+				if (light_pdf > 0.0f)
+				{
+					queue_light(light_index, 1.0f / (light_pdf * num_samples));
+				}
+			}
+		}
+	}
+
+	//direct light rays from the last vertex of escaped paths
+	for (uint32_t i = 0; i < m_escaped.size(); ++i)
+	{
+		for (uint32_t light_index = 0; light_index < lights.size(); ++light_index)
+		{
+			m_shadow.point_x.push_back(m_escaped.origin_x[i]);
+			m_shadow.point_y.push_back(m_escaped.origin_y[i]);
+			m_shadow.light.push_back(light_index);
+			m_shadow.contribution.push_back(lights[light_index]->intensity);
+			m_shadow.hit.push_back(ESCAPED);
+			m_shadow.path.push_back(m_escaped.path[i]);
+		}
+	}
+
+	for (uint32_t q = 0; q < m_shadow.size(); ++q)
+	{
+		const glm::vec2 point(m_shadow.point_x[q], m_shadow.point_y[q]);
+		if (!_scene.is_light_visible(m_shadow.light[q], point, RAY_EPSILON))
+		{
+			continue;
+		}
+
+		if (m_shadow.hit[q] != ESCAPED)
+		{
+			m_hits.illumination[m_shadow.hit[q]] += m_shadow.contribution[q];
+		}
+		else
+		{
+			//segment from the last vertex to the visible light
+			m_segments.emplace_back(point, lights[m_shadow.light[q]]->pos, glm::vec3(0.1f), m_shadow.contribution[q]);
+			m_segment_path.push_back(m_shadow.path[q]);
+		}
+	}
+}
+
+void WavefrontIntegrator::shade(const Scene& _scene, const PathtracerSettings& _settings, int _bounce)
+{
+	m_next_rays.clear();
+	const SampleGenerator sampler(_settings.sampler);
+
+	//group the hits by material type, then by material, so each material is sampled in one run
+	std::vector<size_t> type_keys(_scene.get_material_count());
+	for (uint32_t id = 0; id < type_keys.size(); ++id)
+	{
+		type_keys[id] = typeid(_scene.get_material(id)).hash_code();
+	}
+	m_shade_order.resize(m_hits.size());
+	for (uint32_t h = 0; h < m_hits.size(); ++h)
+	{
+		m_shade_order[h] = h;
+	}
+	std::sort(m_shade_order.begin(), m_shade_order.end(), [&](uint32_t a, uint32_t b)
+		{
+			const uint32_t ma = m_hits.material_id[a];
+			const uint32_t mb = m_hits.material_id[b];
+			return type_keys[ma] != type_keys[mb] ? type_keys[ma] < type_keys[mb] : ma < mb;
+		});
+
+	for (uint32_t h : m_shade_order)
+	{
+		const uint32_t ray = m_hits.ray[h];
+		const glm::vec2 origin = m_rays.origin(ray);
+		const glm::vec2 dir = m_rays.dir(ray);
+		const glm::vec2 hit_pos = origin + dir * m_hits.t[h];
+		const glm::vec2 normal(m_hits.normal_x[h], m_hits.normal_y[h]);
+
+		//sample new direction, same as Pathtracer::sample
+		float pdf = 1.0f;
+		const glm::vec2 t = glm::vec2(-normal.y, normal.x);
+		const glm::vec2 wiLocal = -glm::vec2(glm::dot(t, dir), glm::dot(normal, dir));
+		const Material& material = _scene.get_material(m_hits.material_id[h]);
+		const uint32_t path = m_rays.path[ray];
+		const float xi = sampler.get(m_path_stratum[path], m_path_sample[path], SampleGenerator::material_dimension(_bounce));
+		const glm::vec2 woLocal = material.sample_dir(wiLocal, normal, xi, pdf);
+		const glm::vec2 new_dir = woLocal.y * normal + woLocal.x * t;
+		const glm::vec3 reflectance = material(-dir, new_dir, normal) / pdf;
+
+		glm::vec3 illumination = m_hits.illumination[h] + material.get_self_emitting_value(normal);
+		if (_settings.pure_importance)
+		{
+			illumination = glm::vec3(100.0f);
+		}
+
+		m_segments.emplace_back(origin, hit_pos, reflectance, illumination);
+		m_segment_path.push_back(m_rays.path[ray]);
+		m_next_rays.push(hit_pos + RAY_EPSILON * new_dir, new_dir, m_rays.path[ray]);
+	}
+}
+
+void WavefrontIntegrator::splat(std::vector<DrawData>& _draw_data)
+{
+	//counting sort of the segments by path, keeps the order of the segments within a path
+	std::vector<uint32_t> path_start(m_num_paths + 1, 0);
+	for (uint32_t path : m_segment_path)
+	{
+		++path_start[path + 1];
+	}
+	for (size_t p = 0; p < m_num_paths; ++p)
+	{
+		path_start[p + 1] += path_start[p];
+	}
+	std::vector<uint32_t> order(m_segments.size());
+	std::vector<uint32_t> fill(path_start.begin(), path_start.end() - 1);
+	for (uint32_t s = 0; s < m_segments.size(); ++s)
+	{
+		order[fill[m_segment_path[s]]++] = s;
+	}
+
+	for (size_t p = 0; p < m_num_paths; ++p)
+	{
+		//first path segment has no incoming flux
+		glm::vec3 incoming_flux(0.0f);
+		for (uint32_t i = path_start[p + 1]; i > path_start[p]; --i)
+		{
+			const PathSegment& segment = m_segments[order[i - 1]];
+			incoming_flux += segment.illumination;
+			const glm::vec3 ray_start_flux = incoming_flux * segment.reflectance;
+
+			//line is drawn from destination to origin (bc of reverse direction)
+			const glm::vec2 dir = segment.origin - segment.destination;
+			const float biasCorrection = glm::clamp(glm::length(dir) / glm::max(glm::abs(dir.x), glm::abs(dir.y)), 1.0f, 1.414214f);
+			_draw_data.push_back(DrawData(segment.destination, segment.origin, ray_start_flux * biasCorrection));
+
+			incoming_flux /= std::max(glm::distance(segment.destination, segment.origin), 1.0f);
+		}
+	}
+}
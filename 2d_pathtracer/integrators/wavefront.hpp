@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "pathtracer.hpp"
+#include "../geometry/ray_packet.hpp"
+
+/// \brief Breadth first alternative to Pathtracer::sample
+///
+/// Camera rays are collected into a wave. All paths of the wave advance one bounce at a time,
+/// every stage runs over a whole queue before the next one starts:
+/// extend (closest hits), shadow (next event estimation), shade (sorted by material) and
+/// splat (DrawData of the finished paths). The output is the same as tracing every path with Pathtracer::sample.
+class WavefrontIntegrator
+{
+public:
+	/// queue the rays of a camera packet as new paths
+	void add_camera_rays(const RayPacket& _packet);
+
+	/// number of queued paths
+	size_t size() const { return m_num_paths; }
+
+	/// trace all queued paths and append their segments to _draw_data
+	/// the random numbers of a path are the same as in Pathtracer::trace_path
+	/// \return number of paths whose camera ray hit something (only these count as samples, like in Pathtracer::sample)
+	size_t trace(const Scene& _scene, const PathtracerSettings& _settings, std::vector<DrawData>& _draw_data);
+
+private:
+	/// closest hit for every ray, misses end their path
+	void extend(const Scene& _scene, const PathtracerSettings& _settings, int _bounce);
+	/// next event estimation for every hit, plus the direct light rays of escaped paths
+	void shadow(const Scene& _scene, const PathtracerSettings& _settings, int _bounce);
+	/// samples the materials (grouped by material type) and writes the rays of the next bounce
+	void shade(const Scene& _scene, const PathtracerSettings& _settings, int _bounce);
+	/// turns the segments of all paths into DrawData, like the end of Pathtracer::sample
+	void splat(std::vector<DrawData>& _draw_data);
+
+	/// one ray per active path
+	struct RayQueue
+	{
+		std::vector<float> origin_x, origin_y;
+		std::vector<float> dir_x, dir_y;
+		std::vector<uint32_t> path;
+
+		size_t size() const { return path.size(); }
+		void clear();
+		void push(glm::vec2 _origin, glm::vec2 _dir, uint32_t _path);
+		glm::vec2 origin(size_t i) const { return glm::vec2(origin_x[i], origin_y[i]); }
+		glm::vec2 dir(size_t i) const { return glm::vec2(dir_x[i], dir_y[i]); }
+	};
+
+	/// closest hits found by the extend stage
+	struct HitQueue
+	{
+		//index of the ray in the ray queue
+		std::vector<uint32_t> ray;
+		std::vector<float> t;
+		std::vector<float> normal_x, normal_y;
+		std::vector<uint32_t> material_id;
+		//direct light gathered by the shadow stage
+		std::vector<glm::vec3> illumination;
+
+		size_t size() const { return ray.size(); }
+		void clear();
+	};
+
+	/// visibility tests between a point and a light
+	struct ShadowQueue
+	{
+		std::vector<float> point_x, point_y;
+		std::vector<uint32_t> light;
+		//light arriving if the light is visible
+		std::vector<glm::vec3> contribution;
+		//receiving hit, or ESCAPED for the direct light rays of paths that left the scene
+		std::vector<uint32_t> hit;
+		std::vector<uint32_t> path;
+
+		size_t size() const { return hit.size(); }
+		void clear();
+	};
+
+	static constexpr uint32_t ESCAPED = 0xffffffffu;
+	//same offset as the Pathtracer uses against self intersections
+	static constexpr float RAY_EPSILON = 1e-2f;
+
+	size_t m_num_paths = 0;
+	//camera rays of the next wave, the packets are kept to trace the first bounce together
+	std::vector<RayPacket> m_camera_packets;
+	//stratum and sample of every path, they index its random numbers
+	std::vector<uint32_t> m_path_stratum;
+	std::vector<uint32_t> m_path_sample;
+
+	RayQueue m_rays;
+	RayQueue m_next_rays;
+	HitQueue m_hits;
+	ShadowQueue m_shadow;
+	//rays that left the scene after at least one hit (only used to draw direct light rays)
+	RayQueue m_escaped;
+	//hit indices in shading order
+	std::vector<uint32_t> m_shade_order;
+
+	//segments of all paths in the order they were found, with the index of their path
+	std::vector<PathSegment> m_segments;
+	std::vector<uint32_t> m_segment_path;
+};
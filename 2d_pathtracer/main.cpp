@@ -8,16 +8,37 @@
 #include "integrators/pathtracer.hpp"
 #include "scene/scene_loader.hpp"
 #include "scene/scene_renderer.hpp"
+#include "scene/scene_snapshots.hpp"
 #include "ui/move_objects.hpp"
+#include "ui/batch_render.hpp"
+#include "utils/thread_pool.hpp"
 
 using namespace gpupro;
 using namespace glm;
 
 using Clock = std::chrono::high_resolution_clock;
 
-int main()
+int main(int argc, char** argv)
 try
 {
+	//render without a window if the command line asks for it
+	BatchSettings batch_settings;
+	bool headless = false;
+	try
+	{
+		headless = batch_render::parse_arguments(argc, argv, batch_settings);
+	}
+	catch (const std::runtime_error&)
+	{
+		batch_render::print_usage();
+		throw;
+	}
+	if (headless)
+	{
+		batch_render::run(batch_settings);
+		return 0;
+	}
+
 	Window::Desc d;
 	d.title = "2D Pathtracer";
 	d.width = 800;
@@ -67,7 +88,6 @@ try
 
 	//init pahtracer
 	Pathtracer pathtracer(d.width, d.height, pathProgram);
-	pathtracer.set_scene(g_scene);
 
 	//pathtracer settings
 	pathtracer.settings.path_length = 5;
@@ -75,6 +95,14 @@ try
 	pathtracer.settings.pure_importance = false;
 	pathtracer.settings.exposure = 1.0f;
 
+	//workers for parallel exposures, recreated when settings.num_workers changes
+	auto thread_pool = std::make_unique<ThreadPool>(pathtracer.settings.num_workers);
+	uint32_t pool_workers = pathtracer.settings.num_workers;
+
+	//the UI edits g_scene, the tracer only sees the published versions
+	SceneSnapshots snapshots;
+	bool scene_edited = true;
+
 	UI ui(g_scene);
 	//set callbacks
 	bool stop_pahtracing = false;
@@ -97,6 +125,7 @@ try
 	wnd.setMouseMoveCallback([&](float x, float y, float dx, float dy)
 		{
 			ui.move_object(dx, dy);
+			scene_edited |= stop_pahtracing;
 		});
 
 	wnd.setKeyDownCallback([&](Window::Key key)
@@ -104,6 +133,7 @@ try
 			if (ui.on_key_down(key, pathtracer, g_scene, current_scene, scene_names, scenes_path))
 			{
 				pathtracer.reset();
+				scene_edited = true;
 			}
 		});
 	ui.print_controls();
@@ -116,8 +146,24 @@ try
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		if (!stop_pahtracing) {
+			if (scene_edited)
+			{
+				//rebuild data that is outdated after moving objects
+				g_scene->commit_changes();
+				snapshots.publish(*g_scene);
+				scene_edited = false;
+			}
+			//the exposure uses the newest version, edits of g_scene do not touch it
+			const std::shared_ptr<const Scene> scene = snapshots.pin();
+			pathtracer.set_scene(scene);
+			if (pathtracer.settings.parallel && pool_workers != pathtracer.settings.num_workers)
+			{
+				thread_pool.reset();
+				thread_pool = std::make_unique<ThreadPool>(pathtracer.settings.num_workers);
+				pool_workers = pathtracer.settings.num_workers;
+			}
 			//trace x iterations
-			g_scene->get_camera()->expose(pathtracer, iteration_stepsize);
+			pathtracer.expose(iteration_stepsize, *thread_pool);
 		}
 		//draw result in default frambuffer
 		gpupro::Framebuffer::bindDefaultFramebuffer();
@@ -134,6 +180,14 @@ try
 		printf("\rExposure: %.1f, Timelapse %d , Pure Importance Mode: %d,Draw Direct Light: %d, Path length: %d, Scene name: %s",
 			pathtracer.settings.exposure, pathtracer.settings.timelapse, pathtracer.settings.pure_importance, pathtracer.settings.direct_light_ray,
 			pathtracer.settings.path_length, scene_names[current_scene].c_str());
+		if (pathtracer.settings.parallel)
+		{
+			//scheduler stats of the last frame
+			const ThreadPool::Stats& stats = thread_pool->stats();
+			printf(", Workers: %u, Chunk: %d, Steals: %llu, Idle: %.0f%%  ", thread_pool->size(), pathtracer.settings.chunk_size,
+				static_cast<unsigned long long>(stats.steals), stats.total_seconds > 0.0 ? 100.0 * stats.idle_seconds / stats.total_seconds : 0.0);
+			thread_pool->reset_stats();
+		}
 
 		// Timelapse Mode
 		if (pathtracer.settings.timelapse)
@@ -2,7 +2,6 @@
 
 #include <cmath>
 #include "material.hpp"
-#include "../utils/rng.hpp"
 
 class Dielectric final : public Material
 {
@@ -13,13 +12,13 @@ public:
 		return glm::vec3(1.0f) * reflection_color;
 	}
 
-	glm::vec2 sample_dir(const glm::vec2& _incident, const glm::vec2& _normal, float& _probability)  override
+	glm::vec2 sample_dir(const glm::vec2& _incident, const glm::vec2& _normal, float _xi, float& _probability) const override
 	{
 		float cosThetaT;
 		float eta = _incident.y < 0.0f ? ior : 1.0f / ior;
 		float Fr = dielectric_reflectance(eta, std::abs(_incident.y), cosThetaT);
 
-		if (rng.next() < Fr)
+		if (_xi < Fr)
 		{
 			return glm::vec2(-_incident.x, _incident.y);
 		}
@@ -46,12 +45,11 @@ public:
 		return (Rs * Rs + Rp * Rp) * 0.5f;
 	}
 
-	Dielectric(glm::vec3 _color, float _ior) : Material(_color), ior(_ior), rng(0.0f, 1.0f)
+	Dielectric(glm::vec3 _color, float _ior) : Material(_color), ior(_ior)
 	{
 	}
 
 
 private:
 	float ior;
-	RandomNumberGenerator rng;
 };
@@ -2,7 +2,6 @@
 
 #include <cmath>
 #include "material.hpp"
-#include "../utils/rng.hpp"
 
 class Diffuse final : public Material
 {
@@ -12,18 +11,13 @@ public:
 		return glm::vec3(0.5f) * reflection_color;
 	}
 
-	glm::vec2 sample_dir(const glm::vec2& _incident, const glm::vec2& _normal, float& _probability)  override
+	glm::vec2 sample_dir(const glm::vec2& _incident, const glm::vec2& _normal, float _xi, float& _probability) const override
 	{
-		float xi = rng.next();
-		float sinThetaI = 2.0f * xi - 1.0f;
+		float sinThetaI = 2.0f * _xi - 1.0f;
 		float cosThetaI = std::sqrt(1.0f - sinThetaI * sinThetaI);
 		return glm::vec2(sinThetaI, cosThetaI * glm::sign(_incident.y));
 	}
 
-	Diffuse(glm::vec3 _color) : Material(_color),rng(0.0f, 1.0f)
+	Diffuse(glm::vec3 _color) : Material(_color)
 	{}
-
-
-private:
-	RandomNumberGenerator rng;
 };
\ No newline at end of file
@@ -24,11 +24,14 @@ public:
 	/// This method is called at hit points for the material of the according object.
 	/// The sampling should follow the importance sampling for the current material.
 	/// I.e. directions must be produced proportional to the reflected distribution.
+	/// Materials have no mutable state, the random number comes from the caller, so one material can be
+	/// sampled by several threads at once.
 	/// \param [in] _incident Normalized direction vector pointing away from the
 	///		surface to the observer.
+	/// \param [in] _xi Uniform random number in [0,1) of the caller's sampler.
 	/// \param [out] _probability Return sampling probability for Monte Carlo weight.
 	///		Since the PDF is continuous it can have values > 1. Its area is 1!
-	virtual glm::vec2 sample_dir(const glm::vec2& _incident, const glm::vec2& _normal, float& _probability) = 0;
+	virtual glm::vec2 sample_dir(const glm::vec2& _incident, const glm::vec2& _normal, float _xi, float& _probability) const = 0;
 
 
 	/// \param [in] _normal Normalized direction vector perpendicular to the surface.
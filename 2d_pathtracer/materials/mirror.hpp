@@ -10,7 +10,7 @@ public:
 		return glm::vec3(1.0f) * reflection_color;
 	}
 
-	glm::vec2 sample_dir(const glm::vec2& _incident, const glm::vec2& _normal, float& _probability)  override
+	glm::vec2 sample_dir(const glm::vec2& _incident, const glm::vec2& _normal, float _xi, float& _probability) const override
 	{
 		return glm::vec2(-_incident.x, _incident.y);
 	}
@@ -0,0 +1,191 @@
+#include "angular_hit_map.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+#include "scene.hpp"
+#include "../geometry/primitive.hpp"
+#include "../geometry/intersections.hpp"
+#include "../geometry/ray.hpp"
+
+namespace
+{
+	//bisection depth for intervals whose ends see different primitives
+	constexpr int MAX_DEPTH = 16;
+	constexpr uint32_t MIN_BINS = 64;
+	constexpr uint32_t MAX_BINS = 1u << 16;
+
+	float angle_of(glm::vec2 v)
+	{
+		return std::atan2(v.y, v.x);
+	}
+}
+
+std::vector<glm::vec2> AngularHitMap::find_curve_crossings(const Scene& scene)
+{
+	const PrimitivePools& primitives = scene.get_primitives();
+
+	//the scene may not use a BVH, build a temporary one to find overlapping primitives
+	BVH bvh;
+	bvh.build(primitives.get_all_bounds());
+
+	std::vector<glm::vec2> crossings;
+	for (uint32_t i = 0; i < primitives.size(); ++i)
+	{
+		for (const auto& ellipse : primitives.get_outline_ellipses(primitives.get_handle(i)))
+		{
+			bvh.for_each_overlap(ellipse.get_bounds(), [&](uint32_t j)
+				{
+					//crossings inside an instance are silhouette points of the instance
+					if (j == i)
+					{
+						return;
+					}
+					const auto points = primitives.get_ellipse_crossings(primitives.get_handle(j), ellipse);
+					crossings.insert(crossings.end(), points.begin(), points.end());
+				});
+		}
+	}
+	return crossings;
+}
+
+void AngularHitMap::clear()
+{
+	m_starts.clear();
+	m_primitives.clear();
+	m_bin_first.clear();
+}
+
+uint32_t AngularHitMap::first_hit(const Scene& scene, float angle) const
+{
+	Intersection isect;
+	if (scene.first_intersection(Ray(m_viewpoint, glm::vec2(std::cos(angle), std::sin(angle))), isect))
+	{
+		return isect.primitive_id;
+	}
+	return NO_PRIMITIVE;
+}
+
+void AngularHitMap::push_interval(float start, uint32_t primitive)
+{
+	//merge neighbours with the same first hit
+	if (!m_primitives.empty() && m_primitives.back() == primitive)
+	{
+		return;
+	}
+	m_starts.push_back(start);
+	m_primitives.push_back(primitive);
+}
+
+void AngularHitMap::resolve(const Scene& scene, float lo, float hi, uint32_t lo_primitive, uint32_t hi_primitive,
+                            int depth)
+{
+	if (lo_primitive == hi_primitive)
+	{
+		push_interval(lo, lo_primitive);
+		return;
+	}
+	if (depth >= MAX_DEPTH)
+	{
+		push_interval(lo, AMBIGUOUS);
+		return;
+	}
+
+	const float mid = 0.5f * (lo + hi);
+	const uint32_t mid_primitive = first_hit(scene, mid);
+	resolve(scene, lo, mid, lo_primitive, mid_primitive, depth + 1);
+	resolve(scene, mid, hi, mid_primitive, hi_primitive, depth + 1);
+}
+
+void AngularHitMap::build(const Scene& scene, glm::vec2 viewpoint, const std::vector<glm::vec2>& crossings)
+{
+	clear();
+	m_viewpoint = viewpoint;
+
+	//the first hit can only change at silhouettes and where outlines cross
+	std::vector<float> events = { -glm::pi<float>(), glm::pi<float>() };
+	const PrimitivePools& primitives = scene.get_primitives();
+	for (PrimitiveHandle handle : primitives.get_handles())
+	{
+		for (const auto& point : primitives.get_silhouette_points(handle, viewpoint))
+		{
+			events.push_back(angle_of(point - viewpoint));
+		}
+	}
+	for (const auto& point : crossings)
+	{
+		events.push_back(angle_of(point - viewpoint));
+	}
+	std::sort(events.begin(), events.end());
+	events.erase(std::unique(events.begin(), events.end()), events.end());
+
+	//between two events only straight outlines can cross, and those swap their order when they do.
+	//so if both ends of an interval see the same primitive it is the first hit of the whole interval
+	for (size_t i = 0; i + 1 < events.size(); ++i)
+	{
+		const float lo = events[i];
+		const float hi = events[i + 1];
+		//stay away from the events, the ray would graze the silhouette there. the gaps to the events are not
+		//probed (two segments can cross inside them), so they are AMBIGUOUS and fall back to a traversal
+		const float offset = (hi - lo) * 1e-3f;
+		const uint32_t lo_primitive = first_hit(scene, lo + offset);
+		const uint32_t hi_primitive = first_hit(scene, hi - offset);
+
+		push_interval(lo, AMBIGUOUS);
+		if (lo_primitive == hi_primitive)
+		{
+			//small primitives can be missed by float precision so close to their silhouette, check the middle too
+			const float mid = 0.5f * (lo + hi);
+			const uint32_t mid_primitive = first_hit(scene, mid);
+			if (mid_primitive != lo_primitive)
+			{
+				resolve(scene, lo + offset, mid, lo_primitive, mid_primitive, 1);
+				resolve(scene, mid, hi - offset, mid_primitive, hi_primitive, 1);
+				push_interval(hi - offset, AMBIGUOUS);
+				continue;
+			}
+		}
+		resolve(scene, lo + offset, hi - offset, lo_primitive, hi_primitive, 0);
+		push_interval(hi - offset, AMBIGUOUS);
+	}
+
+	//uniform bins that point to the first interval overlapping them
+	const auto num_bins = static_cast<uint32_t>(glm::clamp(m_starts.size(), size_t(MIN_BINS), size_t(MAX_BINS)));
+	const float bin_width = glm::two_pi<float>() / static_cast<float>(num_bins);
+	m_bin_first.resize(num_bins);
+	uint32_t interval = 0;
+	for (uint32_t b = 0; b < num_bins; ++b)
+	{
+		const float bin_start = -glm::pi<float>() + b * bin_width;
+		while (interval + 1 < m_starts.size() && m_starts[interval + 1] <= bin_start)
+		{
+			++interval;
+		}
+		m_bin_first[b] = interval;
+	}
+}
+
+uint32_t AngularHitMap::lookup(glm::vec2 direction) const
+{
+	if (m_starts.empty())
+	{
+		return AMBIGUOUS;
+	}
+
+	const float angle = angle_of(direction);
+	const auto num_bins = static_cast<uint32_t>(m_bin_first.size());
+	const auto bin = std::min(num_bins - 1, static_cast<uint32_t>((angle + glm::pi<float>()) / glm::two_pi<float>() * num_bins));
+
+	//usually the bin contains only one or two interval borders
+	uint32_t interval = m_bin_first[bin];
+	while (interval > 0 && m_starts[interval] > angle)
+	{
+		--interval;
+	}
+	while (interval + 1 < m_starts.size() && m_starts[interval + 1] <= angle)
+	{
+		++interval;
+	}
+	return m_primitives[interval];
+}
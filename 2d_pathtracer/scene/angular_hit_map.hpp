@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class Scene;
+
+/// \brief Maps the direction of a ray from a fixed viewpoint to the first primitive it hits
+///
+/// In 2D everything visible from a point is described by the first hit over the angle.
+/// The map stores a sorted list of angular intervals with a constant first hit. The interval
+/// borders are the silhouettes of all primitives and the crossings found by bisection,
+/// so the first hit inside an interval is exact. Only tiny intervals around crossings that
+/// could not be separated and the unprobed 0.1% at both ends of every interval are marked AMBIGUOUS.
+class AngularHitMap
+{
+public:
+	static constexpr uint32_t NO_PRIMITIVE = 0xffffffffu;
+	static constexpr uint32_t AMBIGUOUS = 0xfffffffeu;
+
+	/// \brief build the map
+	/// \param [in] scene Scene with a built acceleration structure
+	/// \param [in] viewpoint origin of all rays that are looked up
+	/// \param [in] crossings points where curved outlines cross other outlines (see find_curve_crossings)
+	void build(const Scene& scene, glm::vec2 viewpoint, const std::vector<glm::vec2>& crossings);
+
+	void clear();
+	bool is_valid() const { return !m_starts.empty(); }
+	glm::vec2 get_viewpoint() const { return m_viewpoint; }
+	size_t get_num_intervals() const { return m_starts.size(); }
+
+	/// \return the index of the first primitive hit by a ray from the viewpoint in direction, NO_PRIMITIVE or AMBIGUOUS
+	uint32_t lookup(glm::vec2 direction) const;
+
+	/// Points where ellipses (circles) cross the outlines of other primitives. Straight outlines cross at most once,
+	/// but an ellipse can change its order with another primitive twice between two angles, so these have to be interval borders.
+	static std::vector<glm::vec2> find_curve_crossings(const Scene& scene);
+
+private:
+	uint32_t first_hit(const Scene& scene, float angle) const;
+	//splits [lo, hi] until both ends have the same first hit
+	void resolve(const Scene& scene, float lo, float hi, uint32_t lo_primitive, uint32_t hi_primitive, int depth);
+	void push_interval(float start, uint32_t primitive);
+
+	glm::vec2 m_viewpoint = glm::vec2(0.0f);
+	//start angle in [-pi, pi) and first hit of every interval
+	std::vector<float> m_starts;
+	std::vector<uint32_t> m_primitives;
+	//first interval of each uniform angular bin for constant time lookups
+	std::vector<uint32_t> m_bin_first;
+};
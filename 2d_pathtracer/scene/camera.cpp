@@ -1,37 +1,90 @@
 #include "camera.hpp"
 
+#include <algorithm>
+
 #include "../integrators/raysampler.h"
 #include "../geometry/ray.hpp"
+#include "../geometry/ray_packet.hpp"
 #include "../geometry/2dmath.hpp"
+#include "../utils/thread_pool.hpp"
 
-void Camera::expose(RaySampler& ray_sampler, int num_iterations)
+void Camera::expose(RaySampler& ray_sampler, const SampleGenerator& sampler, uint32_t first_sample, int num_iterations) const
 {
 	//stepsize is size of each "pixel" segment
 	const float stepsize = m_fov / static_cast<float>(resolution);
 
+	//adjacent strata are sampled together as a packet, they are coherent and share the traversal
+	RayPacket packet;
+	packet.origin = this->pos;
+
 	for (int i = 0; i < num_iterations; ++i)
 	{
-		float upper_angle = m_fov / 2;
-		float lower_angle = upper_angle - stepsize;
+		packet.sample = first_sample + i;
 		for (int j = 0; j < resolution; ++j)
 		{
-			float xi = rng.next();
-			//choose random value between upper_angle and lower_angle (linear interpolation?) (jittering)
-			//std::lerp(upper_angle,lower_angle,xi);
-			const float random_angle = upper_angle + xi * (lower_angle - upper_angle);
+			if (packet.count == 0)
+			{
+				packet.first_stratum = j;
+			}
+			//choose random value between the upper and lower angle of stratum j (jittering)
+			const float upper_angle = m_fov / 2 - j * stepsize;
+			const float random_angle = upper_angle - sampler.get(j, packet.sample, SampleGenerator::CAMERA_DIMENSION) * stepsize;
 
-			Ray ray;
-			ray.origin = this->pos;
 			//rotate camera.dir by random angle
-			ray.direction = glm::normalize(rotate(this->get_dir(), random_angle));
+			packet.directions[packet.count++] = glm::normalize(rotate(this->get_dir(), random_angle));
+			if (packet.count == RayPacket::MAX_SIZE || j == resolution - 1)
+			{
+				ray_sampler.sample_packet(packet);
+				packet.count = 0;
+			}
+		}
+	}
+	ray_sampler.finish();
+}
 
+void Camera::expose(RaySampler& ray_sampler, const SampleGenerator& sampler, uint32_t first_sample, int num_iterations,
+                    ThreadPool& pool, int chunk_size) const
+{
+	const float stepsize = m_fov / static_cast<float>(resolution);
+	chunk_size = std::max(1, chunk_size);
+	const int num_chunks = (resolution + chunk_size - 1) / chunk_size;
 
-			ray_sampler.sample(ray);
+	ray_sampler.prepare_workers(pool.size());
 
-			upper_angle = lower_angle;
-			lower_angle -= stepsize;
-		}
-	}
+	const auto idle = [&] { ray_sampler.idle(); };
+
+	//a task is one chunk of strata of one iteration, all iterations of a chunk are adjacent tasks
+	pool.parallel_for(static_cast<uint32_t>(num_iterations * num_chunks), [&](uint32_t task, uint32_t worker)
+		{
+			const int first = static_cast<int>(task / num_iterations) * chunk_size;
+			const int last = std::min(first + chunk_size, resolution);
+
+			RayPacket packet;
+			packet.origin = this->pos;
+			packet.sample = first_sample + task % num_iterations;
+			for (int j = first; j < last; ++j)
+			{
+				if (packet.count == 0)
+				{
+					packet.first_stratum = j;
+				}
+				//jittered angle in stratum j, same as the serial exposure
+				const float upper_angle = m_fov / 2 - j * stepsize;
+				const float random_angle = upper_angle - sampler.get(j, packet.sample, SampleGenerator::CAMERA_DIMENSION) * stepsize;
+				packet.directions[packet.count++] = glm::normalize(rotate(this->get_dir(), random_angle));
+				if (packet.count == RayPacket::MAX_SIZE || j == last - 1)
+				{
+					ray_sampler.sample_packet(packet, worker);
+					packet.count = 0;
+				}
+			}
+		}, idle);
+	//the rays a worker collected are traced in parallel as well, task i finishes worker i
+	pool.parallel_for(pool.size(), [&](uint32_t task, uint32_t)
+		{
+			ray_sampler.finish(task);
+		}, idle);
+	ray_sampler.finish();
 }
 
 bool Camera::is_point_inside(glm::vec2 point) const
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <memory>
+#include <vector>
 #include <glm/glm.hpp>
-#include "../utils/rng.hpp"
+#include "../utils/sampler.hpp"
 
 class RaySampler;
+class ThreadPool;
 
 namespace gpupro
 {
@@ -18,8 +21,7 @@ public:
 	Camera(const glm::vec2& _pos, const glm::vec2& _dir, float _fov, int _resolution) noexcept : pos(_pos),
 		dir(_dir),
 		m_fov(_fov),
-		resolution(_resolution),
-		rng(0.0f, 1.0f)
+		resolution(_resolution)
 	{
 	}
 
@@ -30,7 +32,22 @@ public:
 	float get_fov() const { return m_fov; }
 
 	/// \brief generate camera rays and sample them
-	void expose(RaySampler& ray_sampler, int num_iterations);
+	///
+	/// The camera is shared by all scene versions, so it keeps no state of the exposures. The jitter offset in a stratum only
+	/// depends on (stratum, sample), serial and parallel exposures are identical.
+	/// \param [in] sampler random numbers of the jitter
+	/// \param [in] first_sample sample index of the first iteration, the following ones count up from it
+	void expose(RaySampler& ray_sampler, const SampleGenerator& sampler, uint32_t first_sample, int num_iterations) const;
+
+	/// \brief generate camera rays and sample them on all workers of the pool
+	///
+	/// The resolution * num_iterations rays are split into chunks of adjacent strata. The chunks are ordered by angle, so the
+	/// pool hands every worker a wedge of the fan and balances expensive wedges by stealing.
+	/// \param [in] chunk_size strata per task, best a multiple of RayPacket::MAX_SIZE
+	void expose(RaySampler& ray_sampler, const SampleGenerator& sampler, uint32_t first_sample, int num_iterations,
+	            ThreadPool& pool, int chunk_size = DEFAULT_CHUNK_SIZE) const;
+
+	static constexpr int DEFAULT_CHUNK_SIZE = 64;
 	glm::vec2 get_dir() const { return dir; }
 	glm::vec2 get_pos() const { return pos; }
 
@@ -40,12 +57,13 @@ public:
 
 	bool is_point_inside(glm::vec2 point) const;
 
+	/// \brief copy to edit, the scene versions that share this camera keep it unchanged
+	std::shared_ptr<Camera> clone_view() const { return std::make_shared<Camera>(pos, dir, m_fov, resolution); }
+
 private:
 	glm::vec2 pos;
 	glm::vec2 dir;
 	//in radian
 	float m_fov;
 	int resolution;
-	//for jittering
-	RandomNumberGenerator rng;
 };
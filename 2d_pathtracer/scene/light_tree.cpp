@@ -0,0 +1,106 @@
+#include "light_tree.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include "light.hpp"
+
+void LightTree::build(const std::vector<std::shared_ptr<PointLight>>& _lights, const std::vector<float>& _power)
+{
+	clear();
+	if (_lights.empty())
+	{
+		return;
+	}
+
+	for (const auto& light : _lights)
+	{
+		m_positions.push_back(light->pos);
+	}
+	m_power = _power;
+
+	std::vector<uint32_t> indices(_lights.size());
+	std::iota(indices.begin(), indices.end(), 0u);
+	m_nodes.reserve(2 * _lights.size() - 1);
+	m_nodes.emplace_back();
+	build_node(0, indices, 0, static_cast<uint32_t>(indices.size()));
+}
+
+void LightTree::clear()
+{
+	m_nodes.clear();
+	m_positions.clear();
+	m_power.clear();
+}
+
+void LightTree::build_node(uint32_t _node_index, std::vector<uint32_t>& _lights, uint32_t _begin, uint32_t _end)
+{
+	Node node;
+	for (uint32_t i = _begin; i < _end; ++i)
+	{
+		node.bounds.grow(m_positions[_lights[i]]);
+		node.power += m_power[_lights[i]];
+	}
+
+	if (_end - _begin == 1)
+	{
+		node.index = _lights[_begin];
+		m_nodes[_node_index] = node;
+		return;
+	}
+
+	//median split along the longer axis
+	const glm::vec2 extent = node.bounds.extent();
+	const int axis = extent.x >= extent.y ? 0 : 1;
+	const uint32_t mid = _begin + (_end - _begin) / 2;
+	std::nth_element(_lights.begin() + _begin, _lights.begin() + mid, _lights.begin() + _end,
+		[&](uint32_t l, uint32_t r)
+		{
+			return m_positions[l][axis] < m_positions[r][axis];
+		});
+
+	//the right child directly follows the left one
+	node.index = static_cast<uint32_t>(m_nodes.size());
+	node.is_leaf = false;
+	m_nodes[_node_index] = node;
+	m_nodes.resize(m_nodes.size() + 2);
+	build_node(node.index, _lights, _begin, mid);
+	build_node(node.index + 1, _lights, mid, _end);
+}
+
+float LightTree::importance(const Node& _node, glm::vec2 _point) const
+{
+	//distance to the closest point of the bounds, with the same clamping as the light attenuation
+	const glm::vec2 closest = glm::clamp(_point, _node.bounds.min, _node.bounds.max);
+	return _node.power / glm::max(1.0f, glm::distance(_point, closest));
+}
+
+uint32_t LightTree::sample(glm::vec2 _point, float _xi, float& _pdf) const
+{
+	_pdf = 1.0f;
+	uint32_t node_index = 0;
+	while (!m_nodes[node_index].is_leaf)
+	{
+		const uint32_t left = m_nodes[node_index].index;
+		const float left_importance = importance(m_nodes[left], _point);
+		const float right_importance = importance(m_nodes[left + 1], _point);
+		const float sum = left_importance + right_importance;
+		const float p_left = sum > 0.0f ? left_importance / sum : 0.5f;
+
+		//reuse the random number for the next level
+		if (_xi < p_left)
+		{
+			_xi /= p_left;
+			_pdf *= p_left;
+			node_index = left;
+		}
+		else
+		{
+			_xi = (_xi - p_left) / (1.0f - p_left);
+			_pdf *= 1.0f - p_left;
+			node_index = left + 1;
+		}
+		_xi = glm::min(_xi, 0.99999994f);
+	}
+	return m_nodes[node_index].index;
+}
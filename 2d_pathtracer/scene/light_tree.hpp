@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "../geometry/aabb.hpp"
+
+class PointLight;
+
+/// \brief Binary tree over the point lights for sampling a light by its expected contribution at a point
+///
+/// Every node stores the bounds and the total power of its lights. Sampling walks from the root to a leaf
+/// and chooses a child proportional to power / distance, the same falloff the pathtracer uses for point lights.
+class LightTree
+{
+public:
+	LightTree() = default;
+
+	/// \param [in] _lights all lights of the scene
+	/// \param [in] _power power of every light
+	void build(const std::vector<std::shared_ptr<PointLight>>& _lights, const std::vector<float>& _power);
+
+	void clear();
+	bool empty() const { return m_nodes.empty(); }
+
+	/// \brief choose a light for a shading point
+	/// \param [in] _point shading point
+	/// \param [in] _xi uniform random number in [0,1)
+	/// \param [out] _pdf probability of the returned light
+	/// \return index of the light in Scene::getLights()
+	uint32_t sample(glm::vec2 _point, float _xi, float& _pdf) const;
+
+private:
+	struct Node
+	{
+		AABB bounds;
+		float power = 0.0f;
+		//inner node: index of the left child (the right one follows), leaf: index of the light
+		uint32_t index = 0;
+		bool is_leaf = true;
+	};
+
+	//fills the node at _node_index with the lights [_begin, _end) and builds its children
+	void build_node(uint32_t _node_index, std::vector<uint32_t>& _lights, uint32_t _begin, uint32_t _end);
+	float importance(const Node& _node, glm::vec2 _point) const;
+
+	std::vector<Node> m_nodes;
+	std::vector<glm::vec2> m_positions;
+	std::vector<float> m_power;
+};
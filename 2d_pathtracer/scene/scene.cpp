@@ -1,51 +1,328 @@
 #include "scene.hpp"
 #include "../geometry/primitive.hpp"
 #include "light.hpp"
+#include "../geometry/ray.hpp"
+#include "../geometry/intersections.hpp"
 
 
 void Scene::add_primitive(const std::shared_ptr<Primitive> &_p)
 {
-	m_primitives.push_back(_p);
+	m_pools.write().add(_p);
+}
+
+uint32_t Scene::add_material(const std::shared_ptr<Material>& _material)
+{
+	m_materials.push_back(_material);
+	return static_cast<uint32_t>(m_materials.size() - 1);
 }
 
 void Scene::add_light_source(const std::shared_ptr<PointLight> &_light)
 {
 	m_lights.push_back(_light);
+	m_shadow_maps.emplace_back();
+	m_shadow_map_dirty.push_back(true);
+	m_lights_dirty = true;
 }
 
 void Scene::set_camera(std::shared_ptr<Camera> _camera)
 {
 	m_camera = _camera;
+	m_camera_map_dirty = true;
 }
 
-bool Scene::first_intersection(const Ray &_ray, Intersection &_isect)
+bool Scene::first_intersection(const Ray &_ray, Intersection &_isect) const
 {
-	bool hitAny = false;
+	// Whenever a model is hit, t_max (in isect) is updated.
+	// A new hit is only possible if it is closer -> take the new one.
+	const auto intersect = [this](const uint32_t* indices, uint32_t count, const Ray& ray, Intersection& isect)
+	{
+		return m_pools->intersect(indices, count, ray, isect);
+	};
+
+	switch (m_accelerator_type)
+	{
+	case AcceleratorType::BVH:
+		return m_bvh->first_intersection(_ray, _isect, intersect);
+	case AcceleratorType::GRID:
+		return m_grid->first_intersection(_ray, _isect, intersect);
+	default:
+		break;
+	}
+
 	// Test all models. After an intersection is found it is still not
 	// clear if it is the closest one.
-	for (auto &model : m_primitives)
+	return m_pools->intersect_all(_ray, _isect);
+}
+
+bool Scene::any_intersection(const Ray& _ray, float max_dist) const
+{
+	// Stop at the first primitive with an intersection with distance less than max_dist
+	const auto occluded = [this](const uint32_t* indices, uint32_t count, const Ray& ray, float dist)
+	{
+		return m_pools->occluded(indices, count, ray, dist);
+	};
+
+	switch (m_accelerator_type)
+	{
+	case AcceleratorType::BVH:
+		return m_bvh->any_intersection(_ray, max_dist, occluded);
+	case AcceleratorType::GRID:
+		return m_grid->any_intersection(_ray, max_dist, occluded);
+	default:
+		break;
+	}
+
+	return m_pools->occluded_all(_ray, max_dist);
+}
+
+bool Scene::intersect_primitive(uint32_t _index, const Ray& _ray, Intersection& _isect) const
+{
+	return m_pools->intersect(_index, _ray, _isect);
+}
+
+void Scene::build_acceleration_structure()
+{
+	m_shadow_map_dirty.assign(m_lights.size(), true);
+	m_camera_map_dirty = true;
+	BVH& bvh = m_bvh.rebuild();
+	UniformGrid& grid = m_grid.rebuild();
+	bvh.clear();
+	grid.clear();
+	if (m_accelerator_type == AcceleratorType::LINEAR)
+	{
+		return;
+	}
+
+	const std::vector<AABB> bounds = m_pools->get_all_bounds();
+
+	if (m_accelerator_type == AcceleratorType::BVH)
+	{
+		bvh.build(bounds);
+	}
+	else
+	{
+		grid.build(bounds, get_size());
+	}
+}
+
+void Scene::update_primitive(PrimitiveHandle _handle)
+{
+	//the primitive can cast shadows on every light
+	m_shadow_map_dirty.assign(m_lights.size(), true);
+	m_camera_map_dirty = true;
+
+	switch (m_accelerator_type)
+	{
+	case AcceleratorType::BVH:
+		m_bvh.write().update(m_pools->get_id(_handle), m_pools->get_bounds(_handle));
+		break;
+	case AcceleratorType::GRID:
+		// building the grid is linear in the number of primitives, no need for an incremental update
+		build_acceleration_structure();
+		break;
+	default:
+		break;
+	}
+}
+
+void Scene::update_light(size_t _index)
+{
+	m_shadow_map_dirty[_index] = true;
+	m_lights_dirty = true;
+}
+
+void Scene::move_primitive(PrimitiveHandle _handle, glm::vec2 _delta)
+{
+	m_pools.write().move(_handle, _delta);
+	update_primitive(_handle);
+}
+
+void Scene::move_light(size_t _index, glm::vec2 _delta)
+{
+	auto moved = std::make_shared<PointLight>(*m_lights[_index]);
+	moved->move(_delta.x, _delta.y);
+	m_lights[_index] = std::move(moved);
+	update_light(_index);
+}
+
+void Scene::move_camera(glm::vec2 _delta)
+{
+	auto moved = m_camera->clone_view();
+	moved->move(_delta.x, _delta.y);
+	m_camera = std::move(moved);
+	update_camera();
+}
+
+void Scene::set_camera_dir(glm::vec2 _dir)
+{
+	//rotating does not change the first-hit map
+	auto rotated = m_camera->clone_view();
+	rotated->set_dir(_dir);
+	m_camera = std::move(rotated);
+}
+
+void Scene::commit_changes()
+{
+	std::vector<glm::vec2> crossings;
+	bool has_crossings = false;
+	const auto build_map = [&](CowPtr<AngularHitMap>& map, glm::vec2 viewpoint)
+	{
+		//only depends on the geometry, compute once for all maps
+		if (!has_crossings)
+		{
+			crossings = AngularHitMap::find_curve_crossings(*this);
+			has_crossings = true;
+		}
+		map.rebuild().build(*this, viewpoint, crossings);
+	};
+
+	for (size_t i = 0; i < m_lights.size(); ++i)
+	{
+		if (m_shadow_map_dirty[i])
+		{
+			build_map(m_shadow_maps[i], m_lights[i]->pos);
+			m_shadow_map_dirty[i] = false;
+		}
+	}
+
+	if (m_camera_map_dirty && m_camera)
 	{
-		// Whenever a model is hit, max_dist (in isect) is updated.
-		// A new hit is only possible if it is closer -> take the new one.
-		if (model->first_intersection(_ray, _isect))
+		build_map(m_camera_map, m_camera->get_pos());
+		m_camera_map_dirty = false;
+	}
+
+	if (m_lights_dirty)
+	{
+		//power of a light is the mean of its rgb intensity
+		std::vector<float> power;
+		power.reserve(m_lights.size());
+		for (const auto& light : m_lights)
 		{
-			hitAny = true;
+			power.push_back(glm::dot(light->intensity, glm::vec3(1.0f / 3.0f)));
 		}
+		m_light_table.rebuild().build(power);
+		m_light_tree.rebuild().build(m_lights, power);
+		m_lights_dirty = false;
 	}
-	return hitAny;
 }
 
-bool Scene::any_intersection(const Ray& _ray, float max_dist)
+uint32_t Scene::sample_light(LightSampling _mode, glm::vec2 _point, float _xi, float& _pdf) const
 {
-	// Test all models if there is an intersection with distance less than max_dist
-	for(auto &model : m_primitives)
-	{	
-		if (model->any_interscetion(_ray,max_dist))
+	if (_mode == LightSampling::SPATIAL)
+	{
+		return m_light_tree->sample(_point, _xi, _pdf);
+	}
+	return m_light_table->sample(_xi, _pdf);
+}
+
+bool Scene::first_camera_intersection(const Ray& _ray, Intersection& _isect) const
+{
+	if (!m_camera_map_dirty && m_camera_map->is_valid() && _ray.origin == m_camera_map->get_viewpoint())
+	{
+		const uint32_t primitive = m_camera_map->lookup(_ray.direction);
+		if (primitive == AngularHitMap::NO_PRIMITIVE)
+		{
+			return false;
+		}
+		if (primitive != AngularHitMap::AMBIGUOUS)
+		{
+			//the map only knows the primitive, the hit itself is computed as usual
+			Intersection isect = _isect;
+			if (intersect_primitive(primitive, _ray, isect))
+			{
+				_isect = isect;
+				return true;
+			}
+		}
+	}
+
+	return first_intersection(_ray, _isect);
+}
+
+void Scene::first_camera_intersections(const RayPacket& _packet, Intersection* _isects, bool* _hits) const
+{
+	const bool use_map = !m_camera_map_dirty && m_camera_map->is_valid() && _packet.origin == m_camera_map->get_viewpoint();
+
+	//rays that need a traversal
+	RayPacket pending;
+	pending.origin = _packet.origin;
+	uint32_t pending_index[RayPacket::MAX_SIZE];
+	for (uint32_t k = 0; k < _packet.count; ++k)
+	{
+		_isects[k] = Intersection();
+		_hits[k] = false;
+		if (use_map)
+		{
+			const uint32_t primitive = m_camera_map->lookup(_packet.directions[k]);
+			if (primitive == AngularHitMap::NO_PRIMITIVE)
+			{
+				continue;
+			}
+			if (primitive != AngularHitMap::AMBIGUOUS && intersect_primitive(primitive, _packet.ray(k), _isects[k]))
+			{
+				_hits[k] = true;
+				continue;
+			}
+			_isects[k] = Intersection();
+		}
+		pending_index[pending.count] = k;
+		pending.directions[pending.count++] = _packet.directions[k];
+	}
+
+	if (pending.count == 0)
+	{
+		return;
+	}
+
+	if (m_accelerator_type != AcceleratorType::BVH)
+	{
+		for (uint32_t k = 0; k < pending.count; ++k)
+		{
+			const uint32_t index = pending_index[k];
+			_hits[index] = first_intersection(pending.ray(k), _isects[index]);
+		}
+		return;
+	}
+
+	//the pending rays keep the angular order of the packet
+	Intersection isects[RayPacket::MAX_SIZE];
+	bool hits[RayPacket::MAX_SIZE] = {};
+	m_bvh->first_intersection_packet(pending, isects, hits,
+		[this](const uint32_t* indices, uint32_t count, const Ray& ray, Intersection& isect)
+		{
+			return m_pools->intersect(indices, count, ray, isect);
+		});
+	for (uint32_t k = 0; k < pending.count; ++k)
+	{
+		_isects[pending_index[k]] = isects[k];
+		_hits[pending_index[k]] = hits[k];
+	}
+}
+
+bool Scene::is_light_visible(size_t _index, glm::vec2 _point, float _epsilon) const
+{
+	const PointLight& light = *m_lights[_index];
+	glm::vec2 light_dir = light.pos - _point;
+	const float light_distance = glm::length(light_dir);
+	light_dir /= light_distance;
+
+	if (!m_shadow_map_dirty[_index])
+	{
+		//the shadow map knows the first primitive hit from the light towards the point
+		const uint32_t occluder = m_shadow_maps[_index]->lookup(-light_dir);
+		if (occluder == AngularHitMap::NO_PRIMITIVE)
 		{
 			return true;
 		}
+		Intersection isect;
+		if (occluder != AngularHitMap::AMBIGUOUS && intersect_primitive(occluder, Ray(light.pos, -light_dir), isect))
+		{
+			return light_distance <= isect.t_max;
+		}
 	}
-	return false;
+
+	//shadow ray from the point to the light
+	return !any_intersection(Ray(_point, light_dir), light_distance - _epsilon);
 }
 
 glm::vec2 Scene::toScreenSpace(glm::vec2 vec) const
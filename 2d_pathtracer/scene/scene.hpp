@@ -5,7 +5,14 @@
 #include <glm/glm.hpp>
 
 #include "../geometry/2dtypes.hpp"
+#include "../geometry/primitive_pools.hpp"
+#include "../accelerators/bvh.hpp"
+#include "../accelerators/uniform_grid.hpp"
 #include "camera.hpp"
+#include "angular_hit_map.hpp"
+#include "light_tree.hpp"
+#include "../utils/alias_table.hpp"
+#include "../utils/cow_ptr.hpp"
 
 class Ray;
 class Primitive;
@@ -17,20 +24,55 @@ struct TransformUniform
 	glm::vec2 scene_size;
 };
 
+// spatial index used for the intersection queries
+enum class AcceleratorType
+{
+	LINEAR,
+	BVH,
+	GRID
+};
+
+// how next event estimation chooses the lights
+enum class LightSampling
+{
+	// every light at every vertex
+	ALL,
+	// one light from an alias table proportional to its power
+	POWER,
+	// one light from the light tree proportional to power / distance
+	SPATIAL
+};
+
+/// \brief Geometry, lights, camera and the acceleration structures built over them
+///
+/// A Scene is one version of the scene. Copies share all parts (copy-on-write), an edit of a copy only copies
+/// the parts it changes and replaces moved objects by moved copies. So a copy can be traced on other threads
+/// while the original is edited (see SceneSnapshots).
 class Scene
 {
 public:
 	Scene() = default;
 
+	/// Copy a primitive into the pools, only primitives without a pool (instances) are kept as objects
 	void add_primitive(const std::shared_ptr<Primitive>& _p);
 
+	/// Add a material to the material table
+	/// \return the id of the material, used by primitives and intersections
+	uint32_t add_material(const std::shared_ptr<Material>& _material);
+
+	/// Resolve a material id (only done at shading time)
+	const Material& get_material(uint32_t _id) const { return *m_materials[_id]; }
+	size_t get_material_count() const { return m_materials.size(); }
+
 	/// Add a point light
 	void add_light_source(const std::shared_ptr<PointLight>& _light);
 
 	void set_camera(std::shared_ptr<Camera> _camera);
-	std::shared_ptr<Camera> get_camera() const { return m_camera; }
+	/// the camera is shared with the other versions of the scene, edits go through move_camera and set_camera_dir
+	std::shared_ptr<const Camera> get_camera() const { return m_camera; }
 
-	const std::vector<std::shared_ptr<Primitive>>& getPrimitives() const { return m_primitives; }
+	/// geometry of all primitives, the UI and the scene renderer address them by their handles
+	const PrimitivePools& get_primitives() const { return *m_pools; }
 	const std::vector<std::shared_ptr<PointLight>>& getLights() const { return m_lights; }
 
 	/// Test if there is an intersection and if yes return the intersection
@@ -39,12 +81,77 @@ public:
 	/// \param [in,out] _isect
 	///		If there is an intersection with the current model the distance is set to
 	///		_isect.t_max and the material_id and normal of the Primitive.
-	bool first_intersection(const Ray& _ray, Intersection& _isect);
+	bool first_intersection(const Ray& _ray, Intersection& _isect) const;
 
 	/// Test if there is an intersection with a primitiive with distance less than max_dist
 	/// \param [in] _ray The ray.
 	/// \param [in] _max_dist maximum distance between origin and the hit
-	bool any_intersection(const Ray& _ray, float _max_dist);
+	bool any_intersection(const Ray& _ray, float _max_dist) const;
+
+	/// Build the acceleration structure over all primitives. Has to be called after all primitives are added.
+	void build_acceleration_structure();
+
+	/// Choose the acceleration structure, takes effect with the next build_acceleration_structure()
+	void set_accelerator_type(AcceleratorType _type) { m_accelerator_type = _type; }
+	AcceleratorType get_accelerator_type() const { return m_accelerator_type; }
+
+	/// Update the acceleration structure after a single primitive was moved (the BVH is refitted instead of rebuilt)
+	void update_primitive(PrimitiveHandle _handle);
+
+	/// Intersect a single primitive
+	/// \param [in] _index id of the primitive in the pools (like Intersection::primitive_id)
+	bool intersect_primitive(uint32_t _index, const Ray& _ray, Intersection& _isect) const;
+
+	/// Mark the shadow map of a light as outdated after the light was moved
+	/// \param [in] _index index of the light in getLights()
+	void update_light(size_t _index);
+
+	/// Move a primitive in the pools and update the acceleration structure.
+	/// The pools are copied first if they are shared, copies of the scene keep the old geometry.
+	void move_primitive(PrimitiveHandle _handle, glm::vec2 _delta);
+
+	/// Move a light (replaced by a moved copy, copies of the scene keep the old one)
+	/// \param [in] _index index of the light in getLights()
+	void move_light(size_t _index, glm::vec2 _delta);
+
+	/// Move or rotate the camera (replaced by a moved copy like in move_light)
+	void move_camera(glm::vec2 _delta);
+	void set_camera_dir(glm::vec2 _dir);
+
+	/// Mark the first-hit map of the camera as outdated after the camera was moved
+	/// (rotating does not change it, the map covers all directions)
+	void update_camera() { m_camera_map_dirty = true; }
+
+	/// Choose a light for next event estimation. Not defined for LightSampling::ALL.
+	/// \param [in] _mode POWER or SPATIAL
+	/// \param [in] _point shading point, only used for SPATIAL
+	/// \param [in] _xi uniform random number in [0,1)
+	/// \param [out] _pdf probability of the returned light
+	/// \return index of the light in getLights()
+	uint32_t sample_light(LightSampling _mode, glm::vec2 _point, float _xi, float& _pdf) const;
+
+	/// Rebuild the outdated shadow maps, the camera map and the light sampling structures. Call after editing the scene and before tracing.
+	void commit_changes();
+
+	/// Like first_intersection, but for rays starting at the camera position.
+	/// Uses the first-hit map of the camera and only traverses the acceleration structure if the map can not decide.
+	/// \param [in] _ray The ray.
+	/// \param [in,out] _isect closest intersection
+	bool first_camera_intersection(const Ray& _ray, Intersection& _isect) const;
+
+	/// first_camera_intersection for a packet of camera rays.
+	/// Rays the first-hit map can not decide traverse the BVH together as a packet.
+	/// \param [in] _packet camera rays, sorted by angle
+	/// \param [out] _isects closest intersection of each ray
+	/// \param [out] _hits true for the rays that hit something
+	void first_camera_intersections(const RayPacket& _packet, Intersection* _isects, bool* _hits) const;
+
+	/// Test if a point light is visible from a point (next event estimation)
+	/// Uses the shadow map of the light and only casts a shadow ray if the map can not decide.
+	/// \param [in] _index index of the light in getLights()
+	/// \param [in] _point point that receives the light
+	/// \param [in] _epsilon the shadow ray ignores hits closer than this to the light
+	bool is_light_visible(size_t _index, glm::vec2 _point, float _epsilon) const;
 
 
 	///transform from world space to [-1,1]
@@ -61,14 +168,44 @@ public:
 	{
 		m_scene_height = 0;
 		m_scene_width  = 0;
-		m_primitives.clear();
+		//fresh parts, copies of the scene keep the old ones
+		m_pools = CowPtr<PrimitivePools>();
+		m_materials.clear();
 		m_lights.clear();
+		m_shadow_maps.clear();
+		m_shadow_map_dirty.clear();
+		m_camera_map = CowPtr<AngularHitMap>();
+		m_camera_map_dirty = true;
+		m_light_table = CowPtr<AliasTable>();
+		m_light_tree = CowPtr<LightTree>();
+		m_lights_dirty = true;
+		m_bvh = CowPtr<BVH>();
+		m_grid = CowPtr<UniformGrid>();
+		m_accelerator_type = AcceleratorType::BVH;
 		m_camera = nullptr;
 	}
 
 private:
-	std::vector<std::shared_ptr<Primitive>> m_primitives;
+	//the heavy parts are shared with the copies of the scene until they are edited
+
+	//geometry, material and color of all primitives
+	CowPtr<PrimitivePools> m_pools;
+	//material table, primitives and intersections only store the index
+	std::vector<std::shared_ptr<Material>> m_materials;
 	std::vector<std::shared_ptr<PointLight>> m_lights;
-	std::shared_ptr<Camera> m_camera;
+	//one angular shadow map per light, rebuilt in commit_changes() if marked dirty
+	std::vector<CowPtr<AngularHitMap>> m_shadow_maps;
+	std::vector<bool> m_shadow_map_dirty;
+	//light selection for next event estimation, rebuilt in commit_changes() if lights changed
+	CowPtr<AliasTable> m_light_table;
+	CowPtr<LightTree> m_light_tree;
+	bool m_lights_dirty = true;
+	std::shared_ptr<const Camera> m_camera;
+	//first hit of all rays from the camera position
+	CowPtr<AngularHitMap> m_camera_map;
+	bool m_camera_map_dirty = true;
+	AcceleratorType m_accelerator_type = AcceleratorType::BVH;
+	CowPtr<BVH> m_bvh;
+	CowPtr<UniformGrid> m_grid;
 	float m_scene_width, m_scene_height;
 };
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cmath>
 #include <iomanip>
+#include <map>
 #include <memory>
 #include <string>
 #include <glm/glm.hpp>
@@ -8,12 +10,129 @@
 #include "scene.hpp"
 #include "light.hpp"
 #include "../geometry/2dtypes.hpp"
+#include "../geometry/instance.hpp"
 #include "camera.hpp"
 #include "../materials/diffuse.hpp"
 #include "../materials/mirror.hpp"
 #include "../materials/dielectric.hpp"
 #include "../materials/area_light_material.hpp"
 
+/// \brief loads a primitive with its material from a json geometry entry
+///
+/// \param [in] element geometry entry with type, materialId and optional color
+/// \param [in,out] scene the material is added to the material table of the scene
+static std::shared_ptr<Primitive> load_primitive(const nlohmann::json& element, const std::shared_ptr<Scene>& scene)
+{
+	std::string type = element["type"];
+	int mat_id = element["materialId"];
+
+	glm::vec3 color = glm::vec3(1.0f);
+	//check if reflection_color field exists, if not use vec3(1.0f)
+	if (element.contains("color"))
+	{
+		auto field = element["color"];
+		color = glm::vec3(field[0], field[1], field[2]);
+	}
+
+
+	std::shared_ptr<Primitive> primitive;
+
+	if (type == "segment")
+	{
+		glm::vec2 pointA = glm::vec2(element["a"][0], element["a"][1]);
+		glm::vec2 pointB = glm::vec2(element["b"][0], element["b"][1]);
+		primitive = std::make_shared<Segment>(pointA, pointB, color);
+	}
+	else if (type == "bbox")
+	{
+		glm::vec2 size = glm::vec2(element["size"][0], element["size"][1]);
+		glm::vec2 center = glm::vec2(element["center"][0], element["center"][1]);
+		primitive = std::make_shared<BBox>(center, size, color);
+	}
+	else if (type == "sphere")
+	{
+		glm::vec2 center = glm::vec2(element["center"][0], element["center"][1]);
+		float radius = element["radius"];
+		primitive = std::make_shared<Sphere>(center, radius, color);
+	}
+
+
+	//Set Material of Primitive
+	switch (mat_id)
+	{
+		//Diffuse
+	case 1:
+	{
+		std::shared_ptr<Diffuse> material(std::make_shared<Diffuse>(color));
+		primitive->set_material(scene->add_material(material));
+		break;
+	}
+	//Mirror
+	case 2:
+	{
+		std::shared_ptr<Mirror> material(std::make_shared<Mirror>(color));
+		primitive->set_material(scene->add_material(material));
+		break;
+	}
+	//Dilectric	
+	case 3:
+	{
+		std::shared_ptr<Dielectric> material(std::make_shared<Dielectric>(color, 1.5));
+		primitive->set_material(scene->add_material(material));
+		break;
+	}
+	default:
+		std::cerr << "Wrong material id (no geometry added) \n";
+	}
+
+	return primitive;
+}
+
+/// \brief true if the inverse of the transform is finite (the instances transform rays with it)
+static bool is_invertible(const glm::mat2& linear)
+{
+	//relative to the lengths of the columns, so the test does not depend on the scale of the scene
+	const float columns = glm::length(linear[0]) * glm::length(linear[1]);
+	return std::abs(glm::determinant(linear)) > 1e-6f * columns && std::isfinite(columns);
+}
+
+/// \brief loads the transform of an instance: optional "translation" [x,y], "rotation" in degree,
+/// "scale" (number or [x,y]) or a full "matrix" [[a,b],[c,d]] (row major) instead of rotation and scale
+/// \return false if the linear part can not be inverted (e.g. a scale of 0)
+static bool load_instance_transform(const nlohmann::json& element, glm::mat2& linear, glm::vec2& translation)
+{
+	translation = glm::vec2(0.0f);
+	if (element.contains("translation"))
+	{
+		translation = glm::vec2(element["translation"][0], element["translation"][1]);
+	}
+
+	if (element.contains("matrix"))
+	{
+		//glm matrices are column major
+		const auto& m = element["matrix"];
+		linear = glm::mat2(float(m[0][0]), float(m[1][0]), float(m[0][1]), float(m[1][1]));
+		return is_invertible(linear);
+	}
+
+	glm::vec2 scale(1.0f);
+	if (element.contains("scale"))
+	{
+		const auto& field = element["scale"];
+		scale = field.is_array() ? glm::vec2(field[0], field[1]) : glm::vec2(float(field));
+	}
+	float angle = 0.0f;
+	if (element.contains("rotation"))
+	{
+		angle = element["rotation"];
+		//convert to radian
+		angle *= glm::pi<float>() / 180;
+	}
+	const glm::mat2 rotation(std::cos(angle), std::sin(angle), -std::sin(angle), std::cos(angle));
+	linear = rotation * glm::mat2(scale.x, 0.0f, 0.0f, scale.y);
+	return is_invertible(linear);
+}
+
 /// \brief loads scene from json file
 /// 
 /// \param [in] filepath Path to file
@@ -27,70 +146,46 @@ static void load_scene(const std::string& filepath, const std::shared_ptr<Scene>
 	//load all primitives
 	for (auto& element : j["geometry"])
 	{
+		scene->add_primitive(load_primitive(element, scene));
+	}
 
-		std::string type = element["type"];
-		int mat_id = element["materialId"];
-
-		glm::vec3 color = glm::vec3(1.0f);
-		//check if reflection_color field exists, if not use vec3(1.0f)
-		if (element.contains("color"))
-		{
-			auto field = element["color"];
-			color = glm::vec3(field[0], field[1], field[2]);
-		}
-
-
-		std::shared_ptr<Primitive> primitive;
-
-		if (type == "segment")
-		{
-			glm::vec2 pointA = glm::vec2(element["a"][0], element["a"][1]);
-			glm::vec2 pointB = glm::vec2(element["b"][0], element["b"][1]);
-			primitive = std::make_shared<Segment>(pointA, pointB, color);
-		}
-		else if (type == "bbox")
-		{
-			glm::vec2 size = glm::vec2(element["size"][0], element["size"][1]);
-			glm::vec2 center = glm::vec2(element["center"][0], element["center"][1]);
-			primitive = std::make_shared<BBox>(center, size, color);
-		}
-		else if (type == "sphere")
+	//load prototypes: named groups of primitives that are only stored once
+	std::map<std::string, std::shared_ptr<const Prototype>> prototypes;
+	if (j.contains("prototypes"))
+	{
+		for (auto& [name, geometry] : j["prototypes"].items())
 		{
-			glm::vec2 center = glm::vec2(element["center"][0], element["center"][1]);
-			float radius = element["radius"];
-			primitive = std::make_shared<Sphere>(center, radius, color);
+			std::vector<std::shared_ptr<Primitive>> primitives;
+			for (auto& element : geometry)
+			{
+				primitives.push_back(load_primitive(element, scene));
+			}
+			prototypes[name] = std::make_shared<Prototype>(primitives);
 		}
+	}
 
-
-		//Set Material of Primitive
-		switch (mat_id)
-		{
-			//Diffuse
-		case 1:
-		{
-			std::shared_ptr<Diffuse> material(std::make_shared<Diffuse>(color));
-			primitive->set_material(material);
-			break;
-		}
-		//Mirror
-		case 2:
-		{
-			std::shared_ptr<Mirror> material(std::make_shared<Mirror>(color));
-			primitive->set_material(material);
-			break;
-		}
-		//Dilectric	
-		case 3:
+	//place the prototypes in the scene
+	if (j.contains("instances"))
+	{
+		for (auto& element : j["instances"])
 		{
-			std::shared_ptr<Dielectric> material(std::make_shared<Dielectric>(color, 1.5));
-			primitive->set_material(material);
-			break;
+			const std::string name = element["prototype"];
+			const auto prototype = prototypes.find(name);
+			if (prototype == prototypes.end())
+			{
+				std::cerr << "Unknown prototype " << name << " (no instance added) \n";
+				continue;
+			}
+
+			glm::mat2 linear;
+			glm::vec2 translation;
+			if (!load_instance_transform(element, linear, translation))
+			{
+				std::cerr << "Singular transform of an instance of " << name << " (no instance added) \n";
+				continue;
+			}
+			scene->add_primitive(std::make_shared<Instance>(prototype->second, linear, translation));
 		}
-		default:
-			std::cerr << "Wrong material id (no geometry added) \n";
-		}
-
-		scene->add_primitive(primitive);
 	}
 
 	//load all lights
@@ -117,7 +212,7 @@ static void load_scene(const std::string& filepath, const std::shared_ptr<Scene>
 			primitive = std::make_shared<Segment>(pointA, pointB, color);
 			std::shared_ptr<AreaLightMaterial> material(std::make_shared<AreaLightMaterial>(color, intensity));
 
-			primitive->set_material(material);
+			primitive->set_material(scene->add_material(material));
 			scene->add_primitive(primitive);
 		}
 	}
@@ -133,4 +228,26 @@ static void load_scene(const std::string& filepath, const std::shared_ptr<Scene>
 
 	//load scene width and height
 	scene->set_size(j["scene_size"]["size"][0], j["scene_size"]["size"][1]);
+
+	//optional acceleration structure: "bvh" (default), "grid" or "linear"
+	AcceleratorType accelerator = AcceleratorType::BVH;
+	if (j.contains("accelerator"))
+	{
+		std::string type = j["accelerator"];
+		if (type == "grid")
+		{
+			accelerator = AcceleratorType::GRID;
+		}
+		else if (type == "linear")
+		{
+			accelerator = AcceleratorType::LINEAR;
+		}
+		else if (type != "bvh")
+		{
+			std::cerr << "Unknown accelerator " << type << " (using bvh) \n";
+		}
+	}
+	scene->set_accelerator_type(accelerator);
+	scene->build_acceleration_structure();
+	scene->commit_changes();
 }
@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 #include "scene.hpp"
 #include "../geometry/2dtypes.hpp"
+#include "../geometry/instance.hpp"
 #include "../../shared/framework/framework.h"
 #include "../../shared/framework/VertexArray.h"
 #include "../../shared/framework/Program.h"
@@ -52,20 +53,42 @@ void SceneRenderer::draw_scene(const Scene& scene, const gpupro::Program& triang
 	color_uniform.subDataUpdate(color_data);
 	color_uniform.bindAsUniformBuffer(2);
 
-	for (const auto& m : scene.getPrimitives())
-	{		
-		std::vector<glm::vec2> positions = m->get_draw_vertices();
-		
+	const auto draw_outline = [&](const std::vector<glm::vec2>& positions, const glm::vec3& color)
+	{
 		//create Buffer with those vertices
 		auto posBuffer = gpupro::Buffer<glm::vec2>(gpupro::BufferType::ARRAY, positions);
 		posBuffer.bindAsVertexBuffer(0);
 
-		color_data.color = m->get_color();
+		color_data.color = color;
 		// set color
 		color_uniform.subDataUpdate(color_data);
 		color_uniform.bindAsUniformBuffer(2);
 		
 		glDrawArrays(GL_LINE_LOOP, 0, posBuffer.getNumElements());
+	};
+
+	const PrimitivePools& primitives = scene.get_primitives();
+	for (PrimitiveHandle handle : primitives.get_handles())
+	{
+		//draw every primitive of an instance on its own, otherwise the loop connects them
+		const auto* instance = handle.type() == PrimitiveType::OTHER ?
+			dynamic_cast<const Instance*>(&primitives.get_other(handle)) : nullptr;
+		if (instance)
+		{
+			const PrimitivePools& prototype = instance->get_prototype().get_primitives();
+			for (PrimitiveHandle local : prototype.get_handles())
+			{
+				std::vector<glm::vec2> positions = prototype.get_draw_vertices(local);
+				for (auto& p : positions)
+				{
+					p = instance->to_scene(p);
+				}
+				draw_outline(positions, prototype.get_color(local));
+			}
+			continue;
+		}
+
+		draw_outline(primitives.get_draw_vertices(handle), primitives.get_color(handle));
 	}
 	
 	//draw Camera (two lines from camera origin to point1 and point2)
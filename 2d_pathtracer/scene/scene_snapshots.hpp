@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "scene.hpp"
+
+/// \brief Published versions of a scene (read-copy-update)
+///
+/// The UI edits its own Scene and publishes a copy after each edit. Tracing threads pin the newest copy and
+/// keep using it for a whole exposure, an edit never waits for them. A version is freed when the last
+/// thread that pinned it lets go of it. The copies share all parts that the edit did not change (see Scene).
+class SceneSnapshots
+{
+public:
+	/// Publish a copy of the edited scene as the newest version
+	/// \param [in] _scene scene after commit_changes()
+	void publish(const Scene& _scene)
+	{
+		std::shared_ptr<const Scene> version = std::make_shared<Scene>(_scene);
+		std::atomic_store(&m_current, std::move(version));
+		m_version.fetch_add(1, std::memory_order_release);
+	}
+
+	/// The newest version, stays valid as long as the pointer is held
+	std::shared_ptr<const Scene> pin() const { return std::atomic_load(&m_current); }
+
+	/// Number of published versions
+	uint64_t get_version() const { return m_version.load(std::memory_order_acquire); }
+
+private:
+	std::shared_ptr<const Scene> m_current;
+	std::atomic<uint64_t> m_version{ 0 };
+};
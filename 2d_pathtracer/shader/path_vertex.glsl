@@ -1,7 +1,12 @@
 #version 440 core
 
-layout(location = 0) in vec2 in_position;
-layout(location = 1) in vec3 color;
+//one instance per line segment, the two vertices of the line are generated from gl_VertexID
+layout(location = 0) in vec2 in_start;
+layout(location = 1) in vec2 in_end;
+layout(location = 2) in vec3 color;
+//or a packed line (PackedDrawData): 16 bit fixed point points in [-0.5,1.5] * scene size, RGB9E5 flux
+layout(location = 3) in uvec4 in_packed_points;
+layout(location = 4) in uint in_packed_flux;
 
 layout(location = 0) flat out vec2 start_position;
 layout(location = 1) out vec2 position;
@@ -10,16 +15,41 @@ layout(location = 2) out vec3 ray_start_flux;
 layout(binding = 1) uniform transform
 {
     vec2 u_scene_size;
+    int u_packed;
 };
 
+vec2 decode_point(uvec2 q)
+{
+    return (vec2(q) / 65535.0f * 2.0f - 0.5f) * u_scene_size;
+}
+
+vec3 decode_rgb9e5(uint v)
+{
+    //value = mantissa * 2^(exponent - bias - mantissa bits)
+    float scale = exp2(float(v >> 27u) - 15.0f - 9.0f);
+    return vec3(v & 0x1ffu, (v >> 9u) & 0x1ffu, (v >> 18u) & 0x1ffu) * scale;
+}
+
 void main()
 {
+    vec2 line_start = in_start;
+    vec2 line_end = in_end;
+    vec3 flux = color;
+    if (u_packed != 0)
+    {
+        line_start = decode_point(in_packed_points.xy);
+        line_end = decode_point(in_packed_points.zw);
+        flux = decode_rgb9e5(in_packed_flux);
+    }
+    vec2 in_position = gl_VertexID == 0 ? line_start : line_end;
+
     //set position of start vertex in object space
-    start_position = in_position;
+    //(the end of the segment, it is the provoking vertex of the line that used to set this flat output)
+    start_position = line_end;
     position = in_position;
 
     //set color
-    ray_start_flux = color; 
+    ray_start_flux = flux; 
 
     //transform to [-1,1]
     float x = (in_position.x / u_scene_size.x) * 2.0f - 1.0f;
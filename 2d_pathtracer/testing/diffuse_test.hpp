@@ -7,6 +7,7 @@
 #include "../geometry/intersections.hpp"
 #include "../scene/scene_renderer.hpp"
 #include <vector>
+#include "../utils/rng.hpp"
 #include <iostream>
 
 
@@ -21,6 +22,7 @@ static void test_diffuse(Scene& scene,gpupro::VertexArray& vao, gpupro::Program&
 	glm::vec3 throughput(1.0f);
 	//test
 	Diffuse dif;
+	PCG32 rng;
 	
 	Ray r({20,20},normalize(glm::vec2(1,1)));
 	Segment s({37.5,25},{37.5,50});
@@ -52,7 +54,7 @@ static void test_diffuse(Scene& scene,gpupro::VertexArray& vao, gpupro::Program&
 		glm::vec2 t = glm::vec2(-isect.normal.y, isect.normal.x);
 		glm::vec2 wiLocal = -glm::vec2(glm::dot(t, r.direction), glm::dot(isect.normal, r.direction));
 		//sample new direction
-		glm::vec2 woLocal = dif.sample_dir(wiLocal,isect.normal,p);
+		glm::vec2 woLocal = dif.sample_dir(wiLocal,isect.normal,rng.next_float(),p);
 
 		//transform from local to scene space
 		glm::vec new_dir = (woLocal.y*isect.normal + woLocal.x*t);
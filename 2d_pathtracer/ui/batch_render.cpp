@@ -0,0 +1,215 @@
+#include "batch_render.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "../integrators/pathtracer.hpp"
+#include "../scene/scene_loader.hpp"
+#include "../utils/image_writer.hpp"
+#include "../utils/thread_pool.hpp"
+
+namespace batch_render
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	//camera iterations per exposure, the time budget is checked in between (like a frame of the window)
+	static constexpr int ITERATION_STEPSIZE = 10;
+
+	static int parse_int(const std::string& _name, const std::string& _value, int _min)
+	{
+		size_t end = 0;
+		int result = 0;
+		try
+		{
+			result = std::stoi(_value, &end);
+		}
+		catch (const std::exception&)
+		{
+			end = 0;
+		}
+		if (end == 0 || end != _value.size() || result < _min)
+		{
+			throw std::runtime_error("invalid value '" + _value + "' for " + _name);
+		}
+		return result;
+	}
+
+	static double parse_double(const std::string& _name, const std::string& _value)
+	{
+		size_t end = 0;
+		double result = 0.0;
+		try
+		{
+			result = std::stod(_value, &end);
+		}
+		catch (const std::exception&)
+		{
+			end = 0;
+		}
+		if (end == 0 || end != _value.size() || !(result >= 0.0))
+		{
+			throw std::runtime_error("invalid value '" + _value + "' for " + _name);
+		}
+		return result;
+	}
+
+	bool parse_arguments(int _argc, char** _argv, BatchSettings& _settings)
+	{
+		const std::vector<std::string> args(_argv + std::min(_argc, 1), _argv + _argc);
+		if (std::find(args.begin(), args.end(), "--headless") == args.end())
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < args.size(); ++i)
+		{
+			const std::string& name = args[i];
+			if (name == "--headless")
+			{
+				continue;
+			}
+			if (i + 1 >= args.size())
+			{
+				throw std::runtime_error("missing value for " + name);
+			}
+			const std::string& value = args[++i];
+
+			if (name == "--scene")
+			{
+				_settings.scene_path = value;
+			}
+			else if (name == "--output")
+			{
+				_settings.output_path = value;
+			}
+			else if (name == "--iterations")
+			{
+				_settings.iterations = parse_int(name, value, 0);
+			}
+			else if (name == "--time")
+			{
+				_settings.time_budget = parse_double(name, value);
+			}
+			else if (name == "--path-length")
+			{
+				_settings.path_length = parse_int(name, value, 1);
+			}
+			else if (name == "--exposure")
+			{
+				_settings.exposure = static_cast<float>(parse_double(name, value));
+			}
+			else if (name == "--size")
+			{
+				const size_t x = value.find('x');
+				if (x == std::string::npos)
+				{
+					throw std::runtime_error("invalid value '" + value + "' for " + name + " (expected WxH)");
+				}
+				_settings.width = parse_int(name, value.substr(0, x), 1);
+				_settings.height = parse_int(name, value.substr(x + 1), 1);
+			}
+			else if (name == "--workers")
+			{
+				_settings.num_workers = static_cast<uint32_t>(parse_int(name, value, 0));
+			}
+			else if (name == "--sampler")
+			{
+				if (value != "random" && value != "sobol")
+				{
+					throw std::runtime_error("invalid value '" + value + "' for " + name + " (random or sobol)");
+				}
+				_settings.sampler = value == "sobol" ? SamplerType::SOBOL : SamplerType::RANDOM;
+			}
+			else
+			{
+				throw std::runtime_error("unknown argument " + name);
+			}
+		}
+
+		if (_settings.scene_path.empty() || _settings.output_path.empty())
+		{
+			throw std::runtime_error("--headless needs --scene and --output");
+		}
+		if (!image_writer::is_supported(_settings.output_path))
+		{
+			throw std::runtime_error("unsupported image format of " + _settings.output_path + " (use .pfm, .exr or .png)");
+		}
+		if (_settings.iterations == 0 && _settings.time_budget <= 0.0)
+		{
+			throw std::runtime_error("--iterations 0 needs a --time budget");
+		}
+		return true;
+	}
+
+	void run(const BatchSettings& _settings)
+	{
+		//the loader does not report a missing file
+		if (!std::ifstream(_settings.scene_path))
+		{
+			throw std::runtime_error("cannot open scene " + _settings.scene_path);
+		}
+		auto scene = std::make_shared<Scene>();
+		load_scene(_settings.scene_path, scene);
+
+		//without a GL context the lines are splatted on the CPU
+		Pathtracer pathtracer(_settings.width, _settings.height);
+		pathtracer.settings.path_length = _settings.path_length;
+		pathtracer.settings.exposure = _settings.exposure;
+		pathtracer.settings.sampler = _settings.sampler;
+		pathtracer.settings.num_workers = _settings.num_workers;
+		pathtracer.settings.splat_backend = SplatBackend::CPU;
+
+		//nothing edits the scene, no snapshots needed
+		pathtracer.set_scene(scene);
+		ThreadPool thread_pool(pathtracer.settings.num_workers);
+
+		const Clock::time_point start = Clock::now();
+		double seconds = 0.0;
+		double last_print = -1.0;
+		int done = 0;
+		while (_settings.iterations == 0 || done < _settings.iterations)
+		{
+			const int step = _settings.iterations == 0 ? ITERATION_STEPSIZE : std::min(ITERATION_STEPSIZE, _settings.iterations - done);
+			pathtracer.expose(step, thread_pool);
+			done += step;
+
+			seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			const bool finished = done == _settings.iterations || (_settings.time_budget > 0.0 && seconds >= _settings.time_budget);
+			//progress about once per second
+			if (finished || seconds - last_print >= 1.0)
+			{
+				printf("\rIterations: %d, Paths: %d, Time: %.1f s", done, pathtracer.get_num_iterations(), seconds);
+				fflush(stdout);
+				last_print = seconds;
+			}
+			if (finished)
+			{
+				break;
+			}
+		}
+		printf("\n");
+
+		std::vector<float> image;
+		pathtracer.read_result(image);
+		image_writer::write_image(_settings.output_path, _settings.width, _settings.height, image);
+		printf("Wrote %s (%dx%d, %d paths in %.1f s)\n", _settings.output_path.c_str(), _settings.width, _settings.height,
+			pathtracer.get_num_iterations(), seconds);
+	}
+
+	void print_usage()
+	{
+		printf("Headless rendering:\n"
+			"  --headless --scene <file.json> --output <image.pfm|image.exr|image.png>\n"
+			"  --iterations n       camera iterations (default 1000, 0 = until the time budget is used up)\n"
+			"  --time seconds       stop after this time even if the iterations are not done\n"
+			"  --path-length n      maximum path length (default 5)\n"
+			"  --exposure x         brightness (default 1)\n"
+			"  --size WxH           image size (default 800x800)\n"
+			"  --workers n          tracing threads (default one per hardware thread)\n"
+			"  --sampler s          random or sobol (default random)\n");
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "../utils/sampler.hpp"
+
+/// settings of a headless render from the command line
+struct BatchSettings
+{
+	std::string scene_path;
+	//.pfm or .exr (linear) or .png (gamma corrected like the window)
+	std::string output_path;
+	//camera iterations (every one traces one path per stratum of the camera), 0 = only the time budget
+	int iterations = 1000;
+	//stop after this many seconds even if the iterations are not done, 0 = no limit
+	double time_budget = 0.0;
+	int path_length = 5;
+	float exposure = 1.0f;
+	int width = 800;
+	int height = 800;
+	//0 = one per hardware thread
+	uint32_t num_workers = 0;
+	SamplerType sampler = SamplerType::RANDOM;
+};
+
+///
+/// \brief Renders a scene without a window and writes the image
+///
+/// The lines are accumulated with the SoftwareSplatter, so no GL context is created.
+/// Usage: 2d_pathtracer --headless --scene <file.json> --output <image.pfm|.exr|.png> [--iterations n] [--time seconds]
+///        [--path-length n] [--exposure x] [--size WxH] [--workers n] [--sampler random|sobol]
+namespace batch_render
+{
+	/// \brief reads the arguments of a headless render
+	/// \return false if the arguments do not ask for one (no --headless), throws std::runtime_error for invalid arguments
+	bool parse_arguments(int argc, char** argv, BatchSettings& settings);
+
+	/// \brief renders until the iterations are done or the time budget is used up and writes the image
+	void run(const BatchSettings& settings);
+
+	void print_usage();
+}
@@ -17,24 +17,26 @@ bool UI::mouse_hit_object(glm::vec2 mouse_pos)
 	auto scene_pos = (mouse_pos + 1.0f) / 2.0f * m_scene->get_size();
 
 	//check primitives
-	for (const auto& m : m_scene->getPrimitives())
+	const PrimitivePools& primitives = m_scene->get_primitives();
+	for (PrimitiveHandle handle : primitives.get_handles())
 	{
-		if (m->is_point_inside(scene_pos))
+		if (primitives.is_point_inside(handle, scene_pos))
 		{
 			is_moving_primitive = true;
-			moved_primitive = m;
+			moved_primitive = handle;
 			return true;
 		}
 
 	}
 
 	//check lights
-	for (const auto& light : m_scene->getLights())
+	const auto& lights = m_scene->getLights();
+	for (size_t i = 0; i < lights.size(); ++i)
 	{
-		if (light->is_point_inside(scene_pos))
+		if (lights[i]->is_point_inside(scene_pos))
 		{
 			is_moving_light = true;
-			moved_light = light;
+			moved_light_index = i;
 			return true;
 		}
 
@@ -58,8 +60,6 @@ void UI::mouse_release()
 	is_moving_primitive = false;
 	is_moving_camera = false;
 	is_moving_light = false;
-	moved_primitive = nullptr;
-	moved_light = nullptr;
 }
 
 /// <summary>
@@ -75,19 +75,19 @@ void UI::move_object(float dx, float dy)
 
 	if (is_moving_primitive)
 	{
-		moved_primitive->move(scene_dx, scene_dy);
+		m_scene->move_primitive(moved_primitive, glm::vec2(scene_dx, scene_dy));
 		return;
 	}
 
 	if (is_moving_light)
 	{
-		moved_light->move(scene_dx, scene_dy);
+		m_scene->move_light(moved_light_index, glm::vec2(scene_dx, scene_dy));
 		return;
 	}
 
 	if (is_moving_camera)
 	{
-		m_scene->get_camera()->move(scene_dx, scene_dy);
+		m_scene->move_camera(glm::vec2(scene_dx, scene_dy));
 		return;
 	}
 
@@ -119,6 +119,39 @@ bool UI::on_key_down(gpupro::Window::Key& k, Pathtracer& pathtracer, std::shared
 	case gpupro::Window::Key::D:
 		pathtracer.settings.direct_light_ray = !pathtracer.settings.direct_light_ray;
 		return true;
+		// Cycle light sampling: all lights, power, spatial
+	case gpupro::Window::Key::L:
+		pathtracer.settings.light_sampling = static_cast<LightSampling>((static_cast<int>(pathtracer.settings.light_sampling) + 1) % 3);
+		return true;
+	case gpupro::Window::Key::W:
+		pathtracer.settings.wavefront = !pathtracer.settings.wavefront;
+		return true;
+		// Toggle random numbers: independent / scrambled Sobol
+	case gpupro::Window::Key::O:
+		pathtracer.settings.sampler = pathtracer.settings.sampler == SamplerType::SOBOL ? SamplerType::RANDOM : SamplerType::SOBOL;
+		return true;
+		// Toggle packed lines (12 instead of 28 bytes per line between tracer and GPU)
+	case gpupro::Window::Key::P:
+		pathtracer.settings.packed_draw_data = !pathtracer.settings.packed_draw_data;
+		return true;
+		// Toggle where the lines are accumulated: GL line rasterization / CPU tiles
+	case gpupro::Window::Key::B:
+		pathtracer.settings.splat_backend = pathtracer.settings.splat_backend == SplatBackend::GL ? SplatBackend::CPU : SplatBackend::GL;
+		return true;
+	case gpupro::Window::Key::M:
+		pathtracer.settings.parallel = !pathtracer.settings.parallel;
+		return true;
+		// Cycle the chunk size of parallel exposures: 16 ... 256 strata
+	case gpupro::Window::Key::C:
+		pathtracer.settings.chunk_size = pathtracer.settings.chunk_size >= 256 ? 16 : pathtracer.settings.chunk_size * 2;
+		return true;
+		// Change the number of workers, 0 = one per hardware thread
+	case gpupro::Window::Key::RIGHT:
+		pathtracer.settings.num_workers += 1;
+		return true;
+	case gpupro::Window::Key::LEFT:
+		pathtracer.settings.num_workers = pathtracer.settings.num_workers > 0 ? pathtracer.settings.num_workers - 1 : 0;
+		return true;
 	case gpupro::Window::Key::UP:
 		pathtracer.settings.path_length += 1;
 		return true;
@@ -141,7 +174,7 @@ void UI::rotate_camera()
 {
 	auto cur_dir = m_scene->get_camera()->get_dir();
 	auto new_dir = rotate(cur_dir, -0.174533f);
-	m_scene->get_camera()->set_dir(new_dir);
+	m_scene->set_camera_dir(new_dir);
 }
 
 void UI::print_controls()
@@ -153,4 +186,12 @@ void UI::print_controls()
 	std::cout << "Change Path length: Up and Down Arrow \n";
 	std::cout << "Change Scene : S \n";
 	std::cout << "Toggle Draw Direct Light Ray: D \n";
+	std::cout << "Change Light Sampling (All/Power/Spatial): L \n";
+	std::cout << "Toggle Wavefront Integrator: W \n";
+	std::cout << "Toggle Sampler (Random/Sobol): O \n";
+	std::cout << "Toggle Packed Lines: P \n";
+	std::cout << "Toggle Splatting Backend (GL/CPU): B \n";
+	std::cout << "Toggle Multithreading: M \n";
+	std::cout << "Change Chunk Size of Parallel Exposures: C \n";
+	std::cout << "Change Number of Workers (0 = all cores): Left and Right Arrow \n";
 }
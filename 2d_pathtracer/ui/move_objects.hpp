@@ -18,7 +18,7 @@ public:
 		is_moving_primitive = false;
 		is_moving_light = false;
 		is_moving_camera = false;
-		moved_primitive = nullptr;
+		moved_light_index = 0;
 	}
 
 
@@ -36,9 +36,10 @@ private:
 	bool is_moving_primitive;
 	bool is_moving_light;
 	bool is_moving_camera;
-	//reference to currently moved object
-	std::shared_ptr<Primitive> moved_primitive;
-	std::shared_ptr<PointLight> moved_light;
+	//handle of the currently moved primitive in the scene (moved through the scene, older versions keep it)
+	PrimitiveHandle moved_primitive;
+	//index of the currently moved light in the scene
+	size_t moved_light_index;
 };
 
 
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// \brief Samples an index proportional to a weight in constant time (Vose's alias method)
+class AliasTable
+{
+public:
+	AliasTable() = default;
+
+	/// \brief build the table, if all weights are zero every index gets the same probability
+	/// \param [in] _weights non negative weight of every index
+	void build(const std::vector<float>& _weights)
+	{
+		const auto n = static_cast<uint32_t>(_weights.size());
+		m_entries.assign(n, Entry());
+		m_pdf.assign(n, 0.0f);
+		if (n == 0)
+		{
+			return;
+		}
+
+		double sum = 0.0;
+		for (float w : _weights)
+		{
+			sum += w;
+		}
+
+		//weights scaled so that the average is 1
+		std::vector<float> scaled(n);
+		std::vector<uint32_t> small, large;
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			m_pdf[i] = sum > 0.0 ? static_cast<float>(_weights[i] / sum) : 1.0f / n;
+			scaled[i] = m_pdf[i] * n;
+			(scaled[i] < 1.0f ? small : large).push_back(i);
+		}
+
+		//fill each small entry with the rest of a large one
+		while (!small.empty() && !large.empty())
+		{
+			const uint32_t s = small.back();
+			small.pop_back();
+			const uint32_t l = large.back();
+
+			m_entries[s].probability = scaled[s];
+			m_entries[s].alias = l;
+			scaled[l] -= 1.0f - scaled[s];
+			if (scaled[l] < 1.0f)
+			{
+				large.pop_back();
+				small.push_back(l);
+			}
+		}
+		//the rest is 1 up to rounding errors
+		for (uint32_t i : large)
+		{
+			m_entries[i].probability = 1.0f;
+			m_entries[i].alias = i;
+		}
+		for (uint32_t i : small)
+		{
+			m_entries[i].probability = 1.0f;
+			m_entries[i].alias = i;
+		}
+	}
+
+	/// \param [in] _xi uniform random number in [0,1)
+	/// \param [out] _pdf probability of the returned index
+	uint32_t sample(float _xi, float& _pdf) const
+	{
+		const auto n = static_cast<uint32_t>(m_entries.size());
+		//the integer part selects the entry, the fraction decides between the entry and its alias
+		const float u = _xi * n;
+		const uint32_t i = u < n ? static_cast<uint32_t>(u) : n - 1;
+		const uint32_t index = u - i < m_entries[i].probability ? i : m_entries[i].alias;
+		_pdf = m_pdf[index];
+		return index;
+	}
+
+	float pdf(uint32_t _index) const { return m_pdf[_index]; }
+	bool empty() const { return m_entries.empty(); }
+	size_t size() const { return m_entries.size(); }
+
+private:
+	struct Entry
+	{
+		float probability = 1.0f;
+		uint32_t alias = 0;
+	};
+
+	std::vector<Entry> m_entries;
+	std::vector<float> m_pdf;
+};
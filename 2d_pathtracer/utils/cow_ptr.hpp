@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+/// \brief Copy-on-write value shared between versions of an object
+///
+/// Copying a CowPtr only shares the value. The owner of a copy gets write access through write(), which
+/// first copies the value if another version still uses it, so readers of the other versions never see a change.
+/// Only the thread that edits a version may call write() on it.
+template <typename T>
+class CowPtr
+{
+public:
+	CowPtr() : m_ptr(std::make_shared<T>()) {}
+
+	const T& operator*() const { return *m_ptr; }
+	const T* operator->() const { return m_ptr.get(); }
+
+	/// writable value, copied first if it is shared
+	T& write()
+	{
+		if (is_shared())
+		{
+			m_ptr = std::make_shared<T>(*m_ptr);
+		}
+		return *m_ptr;
+	}
+
+	/// writable value for a rebuild, a shared value is replaced by a default constructed one instead of a copy
+	T& rebuild()
+	{
+		if (is_shared())
+		{
+			m_ptr = std::make_shared<T>();
+		}
+		return *m_ptr;
+	}
+
+private:
+	bool is_shared() const
+	{
+		if (m_ptr.use_count() > 1)
+		{
+			return true;
+		}
+		//the last other version was released, see everything its readers did before
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return false;
+	}
+
+	std::shared_ptr<T> m_ptr;
+};
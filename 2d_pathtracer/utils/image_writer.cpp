@@ -0,0 +1,291 @@
+#include "image_writer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace image_writer
+{
+	static std::ofstream open_file(const std::string& _path)
+	{
+		std::ofstream file(_path, std::ios::binary);
+		if (!file)
+		{
+			throw std::runtime_error("cannot open " + _path + " for writing");
+		}
+		return file;
+	}
+
+	static void check_size(int _width, int _height, const std::vector<float>& _rgb)
+	{
+		if (_width <= 0 || _height <= 0 || _rgb.size() != static_cast<size_t>(_width) * _height * 3)
+		{
+			throw std::runtime_error("image data does not match its size");
+		}
+	}
+
+	void write_pfm(const std::string& _path, int _width, int _height, const std::vector<float>& _rgb)
+	{
+		check_size(_width, _height, _rgb);
+		std::ofstream file = open_file(_path);
+
+		//a negative scale means little endian floats
+		const uint16_t one = 1;
+		const bool little_endian = *reinterpret_cast<const uint8_t*>(&one) == 1;
+		file << "PF\n" << _width << " " << _height << "\n" << (little_endian ? "-1.0" : "1.0") << "\n";
+		//PFM rows are stored bottom to top as well
+		file.write(reinterpret_cast<const char*>(_rgb.data()), static_cast<std::streamsize>(_rgb.size() * sizeof(float)));
+		if (!file)
+		{
+			throw std::runtime_error("cannot write " + _path);
+		}
+	}
+
+	static uint32_t crc32(const uint8_t* _data, size_t _size, uint32_t _crc = 0)
+	{
+		_crc = ~_crc;
+		for (size_t i = 0; i < _size; ++i)
+		{
+			_crc ^= _data[i];
+			for (int bit = 0; bit < 8; ++bit)
+			{
+				_crc = (_crc >> 1) ^ (0xEDB88320u & (0u - (_crc & 1u)));
+			}
+		}
+		return ~_crc;
+	}
+
+	static void append_u32(std::vector<uint8_t>& _out, uint32_t _value)
+	{
+		//PNG and zlib are big endian
+		_out.push_back(static_cast<uint8_t>(_value >> 24));
+		_out.push_back(static_cast<uint8_t>(_value >> 16));
+		_out.push_back(static_cast<uint8_t>(_value >> 8));
+		_out.push_back(static_cast<uint8_t>(_value));
+	}
+
+	/// length, type, data and the crc of type and data
+	static void append_chunk(std::vector<uint8_t>& _out, const char* _type, const std::vector<uint8_t>& _data)
+	{
+		append_u32(_out, static_cast<uint32_t>(_data.size()));
+		const size_t type_begin = _out.size();
+		_out.insert(_out.end(), _type, _type + 4);
+		_out.insert(_out.end(), _data.begin(), _data.end());
+		append_u32(_out, crc32(&_out[type_begin], _out.size() - type_begin));
+	}
+
+	/// zlib stream of stored deflate blocks
+	static std::vector<uint8_t> zlib_store(const std::vector<uint8_t>& _data)
+	{
+		constexpr size_t MAX_BLOCK = 65535;
+		std::vector<uint8_t> out = { 0x78, 0x01 };
+		size_t offset = 0;
+		do
+		{
+			const size_t size = std::min(MAX_BLOCK, _data.size() - offset);
+			const bool last = offset + size == _data.size();
+			out.push_back(last ? 1 : 0);
+			out.push_back(static_cast<uint8_t>(size));
+			out.push_back(static_cast<uint8_t>(size >> 8));
+			out.push_back(static_cast<uint8_t>(~size));
+			out.push_back(static_cast<uint8_t>(~size >> 8));
+			out.insert(out.end(), _data.begin() + offset, _data.begin() + offset + size);
+			offset += size;
+		} while (offset < _data.size());
+
+		//adler32 of the uncompressed data
+		uint32_t a = 1;
+		uint32_t b = 0;
+		for (uint8_t value : _data)
+		{
+			a = (a + value) % 65521;
+			b = (b + a) % 65521;
+		}
+		append_u32(out, b << 16 | a);
+		return out;
+	}
+
+	void write_png(const std::string& _path, int _width, int _height, const std::vector<float>& _rgb)
+	{
+		check_size(_width, _height, _rgb);
+
+		//every row starts with its filter type (0 = none), PNG rows are stored top to bottom
+		const size_t row_size = static_cast<size_t>(_width) * 3 + 1;
+		std::vector<uint8_t> pixels(row_size * _height);
+		for (int y = 0; y < _height; ++y)
+		{
+			const float* src = &_rgb[static_cast<size_t>(_height - 1 - y) * _width * 3];
+			uint8_t* dst = &pixels[y * row_size];
+			dst[0] = 0;
+			for (int i = 0; i < _width * 3; ++i)
+			{
+				//gamma of compose_fragment.glsl, negative values and NaN become black
+				const float value = src[i] > 0.0f ? std::pow(std::min(src[i], 1.0f), 1.0f / 2.2f) : 0.0f;
+				dst[i + 1] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+			}
+		}
+
+		std::vector<uint8_t> header;
+		append_u32(header, static_cast<uint32_t>(_width));
+		append_u32(header, static_cast<uint32_t>(_height));
+		//8 bit RGB, deflate, adaptive filtering, no interlacing
+		header.insert(header.end(), { 8, 2, 0, 0, 0 });
+
+		std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		append_chunk(png, "IHDR", header);
+		append_chunk(png, "IDAT", zlib_store(pixels));
+		append_chunk(png, "IEND", {});
+
+		std::ofstream file = open_file(_path);
+		file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+		if (!file)
+		{
+			throw std::runtime_error("cannot write " + _path);
+		}
+	}
+
+	static void append_le32(std::vector<uint8_t>& _out, uint32_t _value)
+	{
+		//EXR is little endian
+		for (int byte = 0; byte < 4; ++byte)
+		{
+			_out.push_back(static_cast<uint8_t>(_value >> (8 * byte)));
+		}
+	}
+
+	static void append_le64(std::vector<uint8_t>& _out, uint64_t _value)
+	{
+		append_le32(_out, static_cast<uint32_t>(_value));
+		append_le32(_out, static_cast<uint32_t>(_value >> 32));
+	}
+
+	static void append_float(std::vector<uint8_t>& _out, float _value)
+	{
+		uint32_t bits = 0;
+		std::memcpy(&bits, &_value, sizeof(bits));
+		append_le32(_out, bits);
+	}
+
+	/// name, type, size and value of an EXR header attribute
+	static void append_attribute(std::vector<uint8_t>& _out, const char* _name, const char* _type, const std::vector<uint8_t>& _value)
+	{
+		_out.insert(_out.end(), _name, _name + std::strlen(_name) + 1);
+		_out.insert(_out.end(), _type, _type + std::strlen(_type) + 1);
+		append_le32(_out, static_cast<uint32_t>(_value.size()));
+		_out.insert(_out.end(), _value.begin(), _value.end());
+	}
+
+	void write_exr(const std::string& _path, int _width, int _height, const std::vector<float>& _rgb)
+	{
+		check_size(_width, _height, _rgb);
+
+		//magic number and version 2, single part scanline image
+		std::vector<uint8_t> exr = { 0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0 };
+
+		//the channels are sorted by name, 32 bit float without subsampling
+		std::vector<uint8_t> channels;
+		for (const char* name : { "B", "G", "R" })
+		{
+			channels.insert(channels.end(), name, name + 2);
+			append_le32(channels, 2);
+			//pLinear and 3 reserved bytes
+			channels.insert(channels.end(), { 0, 0, 0, 0 });
+			append_le32(channels, 1);
+			append_le32(channels, 1);
+		}
+		channels.push_back(0);
+
+		std::vector<uint8_t> window;
+		append_le32(window, 0);
+		append_le32(window, 0);
+		append_le32(window, static_cast<uint32_t>(_width - 1));
+		append_le32(window, static_cast<uint32_t>(_height - 1));
+
+		std::vector<uint8_t> one;
+		append_float(one, 1.0f);
+		std::vector<uint8_t> center;
+		append_float(center, 0.0f);
+		append_float(center, 0.0f);
+
+		append_attribute(exr, "channels", "chlist", channels);
+		//no compression
+		append_attribute(exr, "compression", "compression", { 0 });
+		append_attribute(exr, "dataWindow", "box2i", window);
+		append_attribute(exr, "displayWindow", "box2i", window);
+		//increasing y
+		append_attribute(exr, "lineOrder", "lineOrder", { 0 });
+		append_attribute(exr, "pixelAspectRatio", "float", one);
+		append_attribute(exr, "screenWindowCenter", "v2f", center);
+		append_attribute(exr, "screenWindowWidth", "float", one);
+		exr.push_back(0);
+
+		//offset table with one entry per scanline, then every scanline as y, size and the planar channels
+		const size_t row_bytes = static_cast<size_t>(_width) * 3 * sizeof(float);
+		const size_t first_row = exr.size() + static_cast<size_t>(_height) * sizeof(uint64_t);
+		for (int y = 0; y < _height; ++y)
+		{
+			append_le64(exr, first_row + static_cast<size_t>(y) * (2 * sizeof(uint32_t) + row_bytes));
+		}
+		for (int y = 0; y < _height; ++y)
+		{
+			append_le32(exr, static_cast<uint32_t>(y));
+			append_le32(exr, static_cast<uint32_t>(row_bytes));
+			//EXR rows are stored top to bottom
+			const float* src = &_rgb[static_cast<size_t>(_height - 1 - y) * _width * 3];
+			for (int channel = 2; channel >= 0; --channel)
+			{
+				for (int x = 0; x < _width; ++x)
+				{
+					append_float(exr, src[3 * x + channel]);
+				}
+			}
+		}
+
+		std::ofstream file = open_file(_path);
+		file.write(reinterpret_cast<const char*>(exr.data()), static_cast<std::streamsize>(exr.size()));
+		if (!file)
+		{
+			throw std::runtime_error("cannot write " + _path);
+		}
+	}
+
+	/// lower case extension without the dot
+	static std::string get_extension(const std::string& _path)
+	{
+		const size_t dot = _path.find_last_of('.');
+		std::string extension = dot == std::string::npos ? "" : _path.substr(dot + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return extension;
+	}
+
+	bool is_supported(const std::string& _path)
+	{
+		const std::string extension = get_extension(_path);
+		return extension == "pfm" || extension == "exr" || extension == "png";
+	}
+
+	void write_image(const std::string& _path, int _width, int _height, const std::vector<float>& _rgb)
+	{
+		const std::string extension = get_extension(_path);
+		if (extension == "pfm")
+		{
+			write_pfm(_path, _width, _height, _rgb);
+		}
+		else if (extension == "exr")
+		{
+			write_exr(_path, _width, _height, _rgb);
+		}
+		else if (extension == "png")
+		{
+			write_png(_path, _width, _height, _rgb);
+		}
+		else
+		{
+			throw std::runtime_error("unsupported image format of " + _path + " (use .pfm, .exr or .png)");
+		}
+	}
+}
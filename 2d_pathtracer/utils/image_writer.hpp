@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+///
+/// \brief Writes the linear RGB images of the pathtracer to disk
+///
+/// The images have width * height RGB values and the first row is the bottom one, like the samples texture.
+/// Errors are thrown as std::runtime_error.
+namespace image_writer
+{
+	/// \brief portable float map, linear values without any conversion
+	void write_pfm(const std::string& path, int width, int height, const std::vector<float>& rgb);
+
+	/// \brief OpenEXR scanline image with 32 bit float channels, linear values without compression
+	void write_exr(const std::string& path, int width, int height, const std::vector<float>& rgb);
+
+	/// \brief 8 bit PNG with the gamma correction of the compose shader (pow(x, 1 / 2.2), clamped to [0, 1])
+	///
+	/// The pixels are stored uncompressed (deflate without compression), no zlib needed.
+	void write_png(const std::string& path, int width, int height, const std::vector<float>& rgb);
+
+	/// \return true if write_image knows the extension of the path
+	bool is_supported(const std::string& path);
+
+	/// \brief chooses the format by the extension of the path (.pfm, .exr or .png)
+	void write_image(const std::string& path, int width, int height, const std::vector<float>& rgb);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/// \brief Bounded lock-free queue for many producers and one consumer
+///
+/// Ring buffer of cells with a sequence number each (D. Vyukov's bounded queue). Producers reserve a
+/// cell with a CAS on the tail, the single consumer owns the head and needs no atomic read-modify-write.
+/// A full queue is reported to the producer instead of blocking it, so the caller chooses the backpressure.
+template <typename T>
+class MPSCQueue
+{
+public:
+	/// \param [in] _capacity maximum number of queued elements, rounded up to a power of two
+	explicit MPSCQueue(size_t _capacity)
+	{
+		size_t capacity = 2;
+		while (capacity < _capacity)
+		{
+			capacity *= 2;
+		}
+		m_mask = capacity - 1;
+		m_cells.reset(new Cell[capacity]);
+		for (size_t i = 0; i < capacity; ++i)
+		{
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MPSCQueue(const MPSCQueue&) = delete;
+	MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+	size_t capacity() const { return m_mask + 1; }
+
+	/// Enqueue, may be called from any thread.
+	/// \param [in,out] _value moved into the queue on success, untouched if the queue is full
+	/// \return false if the queue is full
+	bool try_push(T& _value)
+	{
+		size_t pos = m_tail.load(std::memory_order_relaxed);
+		Cell* cell;
+		while (true)
+		{
+			cell = &m_cells[pos & m_mask];
+			const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+			if (diff == 0)
+			{
+				//the cell is free in this lap, try to reserve it
+				if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (diff < 0)
+			{
+				//the consumer did not free the cell of the last lap yet
+				return false;
+			}
+			else
+			{
+				pos = m_tail.load(std::memory_order_relaxed);
+			}
+		}
+		cell->value = std::move(_value);
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Dequeue, only called from the consumer thread.
+	/// \return false if the queue is empty (or the next element is not published yet)
+	bool try_pop(T& _value)
+	{
+		Cell& cell = m_cells[m_head & m_mask];
+		if (cell.sequence.load(std::memory_order_acquire) != m_head + 1)
+		{
+			return false;
+		}
+		_value = std::move(cell.value);
+		//free the cell for the next lap
+		cell.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+		++m_head;
+		return true;
+	}
+
+private:
+	struct alignas(64) Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	alignas(64) std::atomic<size_t> m_tail{ 0 };
+	alignas(64) size_t m_head = 0;
+	std::unique_ptr<Cell[]> m_cells;
+	size_t m_mask = 0;
+};
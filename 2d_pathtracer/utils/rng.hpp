@@ -1,22 +1,92 @@
 #pragma once
 
-#include <random>
+#include <array>
+#include <cstdint>
 
-class RandomNumberGenerator
+/// \brief PCG32 (M. O'Neill), 64 bit state, one of 2^63 streams
+///
+/// Small-state generator for numbers that are drawn one after another. The renderer uses CounterRNG
+/// (through SampleGenerator), whose numbers do not depend on the order they are drawn in.
+class PCG32
 {
 public:
-	RandomNumberGenerator(const float min, const float max): distribution(min, max)
+	explicit PCG32(uint64_t _seed = 0x853c49e6748fea9bull, uint64_t _stream = 0xda3e39cb94b95bdbull)
 	{
-		std::random_device rd;
-		twister = std::mt19937(rd());
+		seed(_seed, _stream);
 	}
 
-	float next() 
+	void seed(uint64_t _seed, uint64_t _stream)
 	{
-		return distribution(twister);
+		state = 0;
+		inc = (_stream << 1u) | 1u;
+		next_uint();
+		state += _seed;
+		next_uint();
+	}
+
+	uint32_t next_uint()
+	{
+		const uint64_t old_state = state;
+		state = old_state * MULTIPLIER + inc;
+		const auto xorshifted = static_cast<uint32_t>(((old_state >> 18u) ^ old_state) >> 27u);
+		const auto rot = static_cast<uint32_t>(old_state >> 59u);
+		return (xorshifted >> rot) | (xorshifted << ((32u - rot) & 31u));
+	}
+
+	/// uniform in [0,1), 24 random bits
+	float next_float() { return static_cast<float>(next_uint() >> 8) * 0x1p-24f; }
+
+private:
+	static constexpr uint64_t MULTIPLIER = 6364136223846793005ull;
+
+	uint64_t state;
+	uint64_t inc;
+};
+
+/// \brief Counter-based generator (Philox4x32-10, Salmon et al.)
+///
+/// Stateless: the numbers are a hash of (pixel, sample, dimension) and the key, so any number can be
+/// computed directly, in any order and on any thread.
+class CounterRNG
+{
+public:
+	explicit CounterRNG(uint64_t _key = 0x2545f4914f6cdd1dull) :
+		key{ static_cast<uint32_t>(_key), static_cast<uint32_t>(_key >> 32u) }
+	{
+	}
+
+	/// 128 random bits for one (pixel, sample, dimension)
+	std::array<uint32_t, 4> bits(uint32_t _pixel, uint32_t _sample, uint32_t _dimension) const
+	{
+		std::array<uint32_t, 4> counter = { _pixel, _sample, _dimension, 0 };
+		std::array<uint32_t, 2> round_key = key;
+		for (int round = 0; round < 10; ++round)
+		{
+			const uint64_t product0 = uint64_t(M0) * counter[0];
+			const uint64_t product1 = uint64_t(M1) * counter[2];
+			counter = {
+				static_cast<uint32_t>(product1 >> 32u) ^ counter[1] ^ round_key[0],
+				static_cast<uint32_t>(product1),
+				static_cast<uint32_t>(product0 >> 32u) ^ counter[3] ^ round_key[1],
+				static_cast<uint32_t>(product0)
+			};
+			round_key[0] += W0;
+			round_key[1] += W1;
+		}
+		return counter;
+	}
+
+	/// uniform in [0,1)
+	float get(uint32_t _pixel, uint32_t _sample, uint32_t _dimension) const
+	{
+		return static_cast<float>(bits(_pixel, _sample, _dimension)[0] >> 8) * 0x1p-24f;
 	}
 
 private:
-	std::mt19937 twister;
-	std::uniform_real_distribution<float> distribution;
+	static constexpr uint32_t M0 = 0xD2511F53u;
+	static constexpr uint32_t M1 = 0xCD9E8D57u;
+	static constexpr uint32_t W0 = 0x9E3779B9u;
+	static constexpr uint32_t W1 = 0xBB67AE85u;
+
+	std::array<uint32_t, 2> key;
 };
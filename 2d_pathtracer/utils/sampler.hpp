@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+
+#include "rng.hpp"
+
+// how the random numbers of the camera strata and the paths are generated
+enum class SamplerType
+{
+	// independent uniform numbers (counter-based)
+	RANDOM,
+	// Owen-scrambled Sobol points, the samples of a stratum are stratified over the iterations
+	SOBOL
+};
+
+/// \brief Random numbers indexed by (stratum, sample, dimension)
+///
+/// Stateless, so it can be shared by all threads and a number never depends on the order of the calls.
+/// A camera path of stratum j and iteration i draws all its numbers with stratum j and sample i, every decision
+/// on the path has its own dimension (see the dimension layout below).
+///
+/// The Sobol sampler pads one-dimensional Sobol sequences: every dimension of every stratum is an Owen-scrambled
+/// van der Corput sequence with its own seed and shuffled index (B. Burley, Practical Hash-based Owen Scrambling, 2020).
+/// So the samples of each decision are stratified over the iterations, while the dimensions stay uncorrelated.
+class SampleGenerator
+{
+public:
+	explicit SampleGenerator(SamplerType _type = SamplerType::RANDOM) : type(_type) {}
+
+	SamplerType get_type() const { return type; }
+
+	/// \return number in [0,1)
+	float get(uint32_t _stratum, uint32_t _sample, uint32_t _dimension) const
+	{
+		if (type == SamplerType::SOBOL)
+		{
+			const uint32_t seed = hash(_stratum ^ hash(_dimension + SEED));
+			//shuffle the sample order, then scramble the point
+			const uint32_t index = nested_uniform_scramble(_sample, seed);
+			const uint32_t point = nested_uniform_scramble(reverse_bits(index), hash(seed));
+			return static_cast<float>(point >> 8) * 0x1p-24f;
+		}
+		return counter.get(_stratum, _sample, _dimension);
+	}
+
+	// dimension layout of a camera path
+
+	/// jitter in the camera stratum
+	static constexpr uint32_t CAMERA_DIMENSION = 0;
+	/// numbers reserved per bounce
+	static constexpr uint32_t BOUNCE_DIMENSIONS = 1024;
+	/// direction sampled by the material at a bounce
+	static uint32_t material_dimension(int _bounce) { return 1 + _bounce * BOUNCE_DIMENSIONS; }
+	/// _k-th light selected for next event estimation at a bounce
+	static uint32_t light_dimension(int _bounce, uint32_t _k) { return 2 + _bounce * BOUNCE_DIMENSIONS + _k; }
+
+private:
+	static uint32_t reverse_bits(uint32_t x)
+	{
+		x = (x << 16) | (x >> 16);
+		x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+		x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+		x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+		x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+		return x;
+	}
+
+	/// Owen scrambling of the bits of x: every bit is flipped depending on the bits above it
+	static uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed)
+	{
+		x = reverse_bits(x);
+		//Laine-Karras permutation, only higher bits influence lower bits of the reversed value
+		x += seed;
+		x ^= x * 0x6c50b47cu;
+		x ^= x * 0xb82f1e52u;
+		x ^= x * 0xc7afe638u;
+		x ^= x * 0x8d22f6e6u;
+		return reverse_bits(x);
+	}
+
+	/// integer hash (lowbias32, C. Wellons)
+	static uint32_t hash(uint32_t x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return x;
+	}
+
+	static constexpr uint32_t SEED = 0x9e3779b9u;
+
+	SamplerType type;
+	CounterRNG counter;
+};
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Minimal float vector for the intersection kernels and the software splatter.
+// 8 lanes with AVX2 (enable PATHTRACER_USE_AVX2 in cmake), 4 lanes with SSE2 or NEON and a plain loop otherwise.
+// The NEON path needs AArch64 (vdivq_f32, vsqrtq_f32), 32 bit ARM uses the plain loop.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PATHTRACER_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PATHTRACER_SIMD_SSE
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define PATHTRACER_SIMD_NEON
+#endif
+
+namespace simd
+{
+#if defined(PATHTRACER_SIMD_AVX2)
+	constexpr int WIDTH = 8;
+	using native_float = __m256;
+#elif defined(PATHTRACER_SIMD_SSE)
+	constexpr int WIDTH = 4;
+	using native_float = __m128;
+#elif defined(PATHTRACER_SIMD_NEON)
+	constexpr int WIDTH = 4;
+	using native_float = float32x4_t;
+#else
+	constexpr int WIDTH = 4;
+	struct native_float { float v[WIDTH]; };
+#endif
+
+	/// \brief WIDTH floats, comparisons return a vfloat with all bits set in the true lanes
+	struct vfloat
+	{
+		native_float v;
+
+		vfloat() = default;
+		vfloat(native_float _v) : v(_v) {}
+
+		static vfloat broadcast(float f)
+		{
+#if defined(PATHTRACER_SIMD_AVX2)
+			return _mm256_set1_ps(f);
+#elif defined(PATHTRACER_SIMD_SSE)
+			return _mm_set1_ps(f);
+#elif defined(PATHTRACER_SIMD_NEON)
+			return vdupq_n_f32(f);
+#else
+			vfloat r;
+			for (float& x : r.v.v) x = f;
+			return r;
+#endif
+		}
+
+		/// load WIDTH consecutive floats (no alignment needed)
+		static vfloat load(const float* p)
+		{
+#if defined(PATHTRACER_SIMD_AVX2)
+			return _mm256_loadu_ps(p);
+#elif defined(PATHTRACER_SIMD_SSE)
+			return _mm_loadu_ps(p);
+#elif defined(PATHTRACER_SIMD_NEON)
+			return vld1q_f32(p);
+#else
+			vfloat r;
+			for (int i = 0; i < WIDTH; ++i) r.v.v[i] = p[i];
+			return r;
+#endif
+		}
+
+		/// load p[index[i]] into lane i
+		static vfloat gather(const float* p, const uint32_t* index)
+		{
+			alignas(32) float lanes[WIDTH];
+			for (int i = 0; i < WIDTH; ++i)
+			{
+				lanes[i] = p[index[i]];
+			}
+			return load(lanes);
+		}
+	};
+
+#if defined(PATHTRACER_SIMD_AVX2)
+	inline vfloat operator+(vfloat a, vfloat b) { return _mm256_add_ps(a.v, b.v); }
+	inline vfloat operator-(vfloat a, vfloat b) { return _mm256_sub_ps(a.v, b.v); }
+	inline vfloat operator*(vfloat a, vfloat b) { return _mm256_mul_ps(a.v, b.v); }
+	inline vfloat operator/(vfloat a, vfloat b) { return _mm256_div_ps(a.v, b.v); }
+	inline vfloat operator&(vfloat a, vfloat b) { return _mm256_and_ps(a.v, b.v); }
+	inline vfloat operator<(vfloat a, vfloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+	inline vfloat operator<=(vfloat a, vfloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+	inline vfloat operator==(vfloat a, vfloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+	inline vfloat min(vfloat a, vfloat b) { return _mm256_min_ps(a.v, b.v); }
+	inline vfloat max(vfloat a, vfloat b) { return _mm256_max_ps(a.v, b.v); }
+	inline vfloat sqrt(vfloat a) { return _mm256_sqrt_ps(a.v); }
+	inline vfloat floor(vfloat a) { return _mm256_floor_ps(a.v); }
+	/// mask ? a : b
+	inline vfloat select(vfloat mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+	/// one bit per lane
+	inline int movemask(vfloat mask) { return _mm256_movemask_ps(mask.v); }
+#elif defined(PATHTRACER_SIMD_SSE)
+	inline vfloat operator+(vfloat a, vfloat b) { return _mm_add_ps(a.v, b.v); }
+	inline vfloat operator-(vfloat a, vfloat b) { return _mm_sub_ps(a.v, b.v); }
+	inline vfloat operator*(vfloat a, vfloat b) { return _mm_mul_ps(a.v, b.v); }
+	inline vfloat operator/(vfloat a, vfloat b) { return _mm_div_ps(a.v, b.v); }
+	inline vfloat operator&(vfloat a, vfloat b) { return _mm_and_ps(a.v, b.v); }
+	inline vfloat operator<(vfloat a, vfloat b) { return _mm_cmplt_ps(a.v, b.v); }
+	inline vfloat operator<=(vfloat a, vfloat b) { return _mm_cmple_ps(a.v, b.v); }
+	inline vfloat operator==(vfloat a, vfloat b) { return _mm_cmpeq_ps(a.v, b.v); }
+	inline vfloat min(vfloat a, vfloat b) { return _mm_min_ps(a.v, b.v); }
+	inline vfloat max(vfloat a, vfloat b) { return _mm_max_ps(a.v, b.v); }
+	inline vfloat sqrt(vfloat a) { return _mm_sqrt_ps(a.v); }
+	/// for |a| < 2^31 (SSE2 has no rounding instruction)
+	inline vfloat floor(vfloat a)
+	{
+		const __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+		//truncation rounds negative values up
+		return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a.v), _mm_set1_ps(1.0f)));
+	}
+	inline vfloat select(vfloat mask, vfloat a, vfloat b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+	}
+	inline int movemask(vfloat mask) { return _mm_movemask_ps(mask.v); }
+#elif defined(PATHTRACER_SIMD_NEON)
+	inline vfloat operator+(vfloat a, vfloat b) { return vaddq_f32(a.v, b.v); }
+	inline vfloat operator-(vfloat a, vfloat b) { return vsubq_f32(a.v, b.v); }
+	inline vfloat operator*(vfloat a, vfloat b) { return vmulq_f32(a.v, b.v); }
+	inline vfloat operator/(vfloat a, vfloat b) { return vdivq_f32(a.v, b.v); }
+	inline vfloat operator&(vfloat a, vfloat b)
+	{
+		return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v)));
+	}
+	inline vfloat operator<(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vcltq_f32(a.v, b.v)); }
+	inline vfloat operator<=(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vcleq_f32(a.v, b.v)); }
+	inline vfloat operator==(vfloat a, vfloat b) { return vreinterpretq_f32_u32(vceqq_f32(a.v, b.v)); }
+	inline vfloat min(vfloat a, vfloat b) { return vminq_f32(a.v, b.v); }
+	inline vfloat max(vfloat a, vfloat b) { return vmaxq_f32(a.v, b.v); }
+	inline vfloat sqrt(vfloat a) { return vsqrtq_f32(a.v); }
+	/// for |a| < 2^31
+	inline vfloat floor(vfloat a)
+	{
+		const float32x4_t truncated = vcvtq_f32_s32(vcvtq_s32_f32(a.v));
+		//truncation rounds negative values up
+		const uint32x4_t too_large = vcgtq_f32(truncated, a.v);
+		return vsubq_f32(truncated, vreinterpretq_f32_u32(vandq_u32(too_large, vreinterpretq_u32_f32(vdupq_n_f32(1.0f)))));
+	}
+	inline vfloat select(vfloat mask, vfloat a, vfloat b) { return vbslq_f32(vreinterpretq_u32_f32(mask.v), a.v, b.v); }
+	inline int movemask(vfloat mask)
+	{
+		const uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(mask.v), 31);
+		return static_cast<int>(vgetq_lane_u32(bits, 0) | vgetq_lane_u32(bits, 1) << 1 |
+			vgetq_lane_u32(bits, 2) << 2 | vgetq_lane_u32(bits, 3) << 3);
+	}
+#else
+	namespace detail
+	{
+		template <typename Op>
+		vfloat apply(vfloat a, vfloat b, Op op)
+		{
+			vfloat r;
+			for (int i = 0; i < WIDTH; ++i) r.v.v[i] = op(a.v.v[i], b.v.v[i]);
+			return r;
+		}
+
+		inline float mask_value(bool b)
+		{
+			//all bits set, like the comparison results of the simd instruction sets
+			const uint32_t bits = b ? 0xffffffffu : 0u;
+			float f;
+			std::memcpy(&f, &bits, sizeof(float));
+			return f;
+		}
+
+		inline bool is_set(float f)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &f, sizeof(float));
+			return bits != 0;
+		}
+	}
+
+	inline vfloat operator+(vfloat a, vfloat b) { return detail::apply(a, b, [](float x, float y) { return x + y; }); }
+	inline vfloat operator-(vfloat a, vfloat b) { return detail::apply(a, b, [](float x, float y) { return x - y; }); }
+	inline vfloat operator*(vfloat a, vfloat b) { return detail::apply(a, b, [](float x, float y) { return x * y; }); }
+	inline vfloat operator/(vfloat a, vfloat b) { return detail::apply(a, b, [](float x, float y) { return x / y; }); }
+	inline vfloat operator&(vfloat a, vfloat b)
+	{
+		return detail::apply(a, b, [](float x, float y) { return detail::mask_value(detail::is_set(x) && detail::is_set(y)); });
+	}
+	inline vfloat operator<(vfloat a, vfloat b) { return detail::apply(a, b, [](float x, float y) { return detail::mask_value(x < y); }); }
+	inline vfloat operator<=(vfloat a, vfloat b) { return detail::apply(a, b, [](float x, float y) { return detail::mask_value(x <= y); }); }
+	inline vfloat operator==(vfloat a, vfloat b) { return detail::apply(a, b, [](float x, float y) { return detail::mask_value(x == y); }); }
+	inline vfloat min(vfloat a, vfloat b) { return detail::apply(a, b, [](float x, float y) { return y < x ? y : x; }); }
+	inline vfloat max(vfloat a, vfloat b) { return detail::apply(a, b, [](float x, float y) { return y > x ? y : x; }); }
+	inline vfloat sqrt(vfloat a) { return detail::apply(a, a, [](float x, float) { return std::sqrt(x); }); }
+	inline vfloat floor(vfloat a) { return detail::apply(a, a, [](float x, float) { return std::floor(x); }); }
+	inline vfloat select(vfloat mask, vfloat a, vfloat b)
+	{
+		vfloat r;
+		for (int i = 0; i < WIDTH; ++i) r.v.v[i] = detail::is_set(mask.v.v[i]) ? a.v.v[i] : b.v.v[i];
+		return r;
+	}
+	inline int movemask(vfloat mask)
+	{
+		int bits = 0;
+		for (int i = 0; i < WIDTH; ++i) bits |= detail::is_set(mask.v.v[i]) ? 1 << i : 0;
+		return bits;
+	}
+#endif
+
+	inline vfloat operator>=(vfloat a, vfloat b) { return b <= a; }
+	inline vfloat operator>(vfloat a, vfloat b) { return b < a; }
+
+	/// write all lanes to memory
+	inline void store(vfloat a, float* p)
+	{
+#if defined(PATHTRACER_SIMD_AVX2)
+		_mm256_storeu_ps(p, a.v);
+#elif defined(PATHTRACER_SIMD_SSE)
+		_mm_storeu_ps(p, a.v);
+#elif defined(PATHTRACER_SIMD_NEON)
+		vst1q_f32(p, a.v);
+#else
+		for (int i = 0; i < WIDTH; ++i) p[i] = a.v.v[i];
+#endif
+	}
+
+	/// value of a single lane
+	inline float extract(vfloat a, int lane)
+	{
+		alignas(32) float lanes[WIDTH];
+		store(a, lanes);
+		return lanes[lane];
+	}
+
+	/// smallest value of all lanes
+	inline float reduce_min(vfloat a)
+	{
+		alignas(32) float lanes[WIDTH];
+		store(a, lanes);
+		float m = lanes[0];
+		for (int i = 1; i < WIDTH; ++i)
+		{
+			m = lanes[i] < m ? lanes[i] : m;
+		}
+		return m;
+	}
+
+	/// index of the lowest set bit (mask must not be 0)
+	inline int first_lane(int mask)
+	{
+		int lane = 0;
+		while ((mask & 1) == 0)
+		{
+			mask >>= 1;
+			++lane;
+		}
+		return lane;
+	}
+
+	/// lanes [0, count) set
+	inline vfloat lane_mask(int count)
+	{
+		alignas(32) float lanes[WIDTH];
+		for (int i = 0; i < WIDTH; ++i)
+		{
+			lanes[i] = i < count ? 0.0f : 1.0f;
+		}
+		return vfloat::load(lanes) < vfloat::broadcast(0.5f);
+	}
+}
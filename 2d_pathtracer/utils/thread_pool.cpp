@@ -0,0 +1,171 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+
+ThreadPool::ThreadPool(uint32_t _num_workers)
+{
+	if (_num_workers == 0)
+	{
+		_num_workers = std::max(1u, std::thread::hardware_concurrency());
+	}
+	m_queues.reset(new Queue[_num_workers]);
+	for (uint32_t worker = 1; worker < _num_workers; ++worker)
+	{
+		m_threads.emplace_back([this, worker] { worker_loop(worker); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_start.notify_all();
+	for (auto& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::parallel_for(uint32_t _num_tasks, const std::function<void(uint32_t, uint32_t)>& _fn,
+                              const std::function<void()>& _on_wait)
+{
+	if (_num_tasks == 0)
+	{
+		return;
+	}
+
+	const auto start = Clock::now();
+	const uint32_t num_workers = size();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_fn = &_fn;
+		//contiguous ranges, the workers only meet when one of them runs out of work
+		for (uint32_t worker = 0; worker < num_workers; ++worker)
+		{
+			Queue& queue = m_queues[worker];
+			queue.begin = static_cast<uint32_t>(uint64_t(_num_tasks) * worker / num_workers);
+			queue.end = static_cast<uint32_t>(uint64_t(_num_tasks) * (worker + 1) / num_workers);
+			queue.steals = 0;
+			queue.busy_seconds = 0.0;
+		}
+		m_active = static_cast<uint32_t>(m_threads.size());
+		++m_job;
+	}
+	m_start.notify_all();
+
+	run_tasks(0);
+
+	//every thread has to leave the job before the next one can start
+	std::unique_lock<std::mutex> lock(m_mutex);
+	const auto finished = [this] { return m_active == 0; };
+	if (_on_wait)
+	{
+		while (!m_done.wait_for(lock, std::chrono::milliseconds(1), finished))
+		{
+			lock.unlock();
+			_on_wait();
+			lock.lock();
+		}
+	}
+	else
+	{
+		m_done.wait(lock, finished);
+	}
+	m_fn = nullptr;
+
+	const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	m_stats.jobs++;
+	m_stats.tasks += _num_tasks;
+	m_stats.total_seconds += seconds * num_workers;
+	for (uint32_t worker = 0; worker < num_workers; ++worker)
+	{
+		m_stats.steals += m_queues[worker].steals;
+		m_stats.idle_seconds += std::max(0.0, seconds - m_queues[worker].busy_seconds);
+	}
+}
+
+void ThreadPool::worker_loop(uint32_t _worker)
+{
+	uint64_t last_job = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_start.wait(lock, [&] { return m_stop || m_job != last_job; });
+			if (m_stop)
+			{
+				return;
+			}
+			last_job = m_job;
+		}
+
+		run_tasks(_worker);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_active == 0)
+		{
+			m_done.notify_all();
+		}
+	}
+}
+
+void ThreadPool::run_tasks(uint32_t _worker)
+{
+	const auto start = Clock::now();
+	uint32_t task;
+	while (pop(_worker, task) || steal(_worker, task))
+	{
+		(*m_fn)(task, _worker);
+	}
+	m_queues[_worker].busy_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+bool ThreadPool::pop(uint32_t _worker, uint32_t& _task)
+{
+	Queue& queue = m_queues[_worker];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.begin == queue.end)
+	{
+		return false;
+	}
+	_task = queue.begin++;
+	return true;
+}
+
+bool ThreadPool::steal(uint32_t _worker, uint32_t& _task)
+{
+	const uint32_t num_workers = size();
+	for (uint32_t i = 1; i < num_workers; ++i)
+	{
+		Queue& victim = m_queues[(_worker + i) % num_workers];
+		uint32_t begin, end;
+		{
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			const uint32_t count = victim.end - victim.begin;
+			if (count == 0)
+			{
+				continue;
+			}
+			//the back half, the victim keeps the tasks next to the ones it is working on
+			end = victim.end;
+			begin = end - (count + 1) / 2;
+			victim.end = begin;
+		}
+
+		Queue& queue = m_queues[_worker];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.begin = begin + 1;
+			queue.end = end;
+		}
+		queue.steals++;
+		_task = begin;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// \brief Persistent worker threads for data parallel loops
+///
+/// The threads are created once and sleep between jobs. The thread that calls parallel_for
+/// works as worker 0, so a pool of size n uses n - 1 extra threads.
+///
+/// The tasks of a job are split into one contiguous range per worker. A worker runs its range
+/// from the front and, once it is empty, steals the back half of the range of another worker.
+/// Neighbouring tasks stay on one worker while the work is balanced, uneven task costs are
+/// balanced by stealing.
+class ThreadPool
+{
+public:
+	/// scheduler counters, accumulated over all jobs since the last reset_stats()
+	struct Stats
+	{
+		uint64_t jobs = 0;
+		uint64_t tasks = 0;
+		//ranges taken from another worker
+		uint64_t steals = 0;
+		//time the workers spent inside a job without a task, summed over all workers
+		double idle_seconds = 0.0;
+		//wall time of all jobs times the number of workers
+		double total_seconds = 0.0;
+	};
+
+	/// \param [in] _num_workers number of workers including the calling thread, 0 = one per hardware thread
+	explicit ThreadPool(uint32_t _num_workers = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	uint32_t size() const { return static_cast<uint32_t>(m_threads.size()) + 1; }
+
+	/// Calls _fn(task, worker) for every task in [0, _num_tasks) and returns when all tasks are done.
+	/// A worker index is only used by one thread at a time, so it can select per thread data.
+	/// \param [in] _on_wait optional, called repeatedly on the calling thread while it waits for the other workers
+	void parallel_for(uint32_t _num_tasks, const std::function<void(uint32_t, uint32_t)>& _fn,
+	                  const std::function<void()>& _on_wait = nullptr);
+
+	const Stats& stats() const { return m_stats; }
+	void reset_stats() { m_stats = Stats(); }
+
+private:
+	/// task range of one worker, the owner takes from the front and thieves from the back
+	struct alignas(64) Queue
+	{
+		std::mutex mutex;
+		uint32_t begin = 0;
+		uint32_t end = 0;
+		//only written by the owner while a job runs
+		uint64_t steals = 0;
+		double busy_seconds = 0.0;
+	};
+
+	void worker_loop(uint32_t _worker);
+	void run_tasks(uint32_t _worker);
+	bool pop(uint32_t _worker, uint32_t& _task);
+	bool steal(uint32_t _worker, uint32_t& _task);
+
+	std::vector<std::thread> m_threads;
+	std::unique_ptr<Queue[]> m_queues;
+
+	std::mutex m_mutex;
+	std::condition_variable m_start;
+	std::condition_variable m_done;
+	//incremented for every job, wakes up the workers
+	uint64_t m_job = 0;
+	//threads that did not finish the current job yet
+	uint32_t m_active = 0;
+	bool m_stop = false;
+
+	const std::function<void(uint32_t, uint32_t)>* m_fn = nullptr;
+	Stats m_stats;
+};
@@ -50,6 +50,13 @@ namespace gpupro
         /// \param data initial data
         Buffer(BufferType type, const TElement& data);
 
+        /// creates a buffer that stays mapped (persistent and coherent) and is written by the cpu as a ring,
+        /// see streamReserve() and streamFence()
+        /// \param type specify main purpose of this buffer (usage: BufferType::ARRAY)
+        /// \param numElements capacity of the ring
+        /// \param numRegions the ring is split into regions, a region is only overwritten after the gpu finished reading it
+        static Buffer streaming(BufferType type, GLuint numElements, GLuint numRegions = 3);
+
         // default constructor for empty buffer (m_id = 0)
         Buffer() = default;
         ~Buffer();
@@ -81,6 +88,16 @@ namespace gpupro
         /// \param data data that replaces the buffer contents (must be the same size as the buffer)
         void subDataUpdate(const TElement& data);
 
+        /// reserves count consecutive elements of a streaming buffer, waits if the gpu still reads a region that is reused
+        /// the previously reserved elements must already be drawn (or be no longer needed)
+        /// \param count number of elements (at most getNumElements())
+        /// \param firstElement index of the first reserved element, for draw calls or binding offsets
+        /// \return mapped memory of the reserved elements, write only
+        TElement* streamReserve(GLuint count, GLuint& firstElement);
+
+        /// marks the end of the draw calls that read the reserved elements, their regions are reused once the gpu got here
+        void streamFence();
+
         GLuint getNumElements() const { return m_size / sizeof(TElement); }
         GLuint getID() { return m_id; }
 
@@ -88,18 +105,39 @@ namespace gpupro
         /// refreshes the contents of the entire buffer
         void subDataUpdate(const void* data);
 
+        /// waits until the gpu finished the draw calls of the last fence of region
+        void waitRegion(GLuint region);
+
         void swap(Buffer<TElement>& o) noexcept
         {
             std::swap(m_id, o.m_id);
             std::swap(m_type, o.m_type);
             std::swap(m_size, o.m_size);
             std::swap(m_flags, o.m_flags);
+            std::swap(m_mapped, o.m_mapped);
+            std::swap(m_head, o.m_head);
+            std::swap(m_regionSize, o.m_regionSize);
+            std::swap(m_currentRegion, o.m_currentRegion);
+            std::swap(m_fences, o.m_fences);
+            std::swap(m_written, o.m_written);
         }
 
         GLuint m_id = 0;
         BufferType m_type;
         GLsizei m_size;
         GLenum m_flags;
+
+        // streaming buffers only
+        TElement* m_mapped = nullptr;
+        // next element to reserve
+        GLuint m_head = 0;
+        GLuint m_regionSize = 0;
+        // region of the last reserved element
+        GLuint m_currentRegion = 0;
+        // per region: fence after the last draw calls that read it
+        std::vector<GLsync> m_fences;
+        // per region: written since the last streamFence()
+        std::vector<bool> m_written;
     };
 
     // Implementations:
@@ -129,9 +167,38 @@ namespace gpupro
     {
     }
 
+    template <class TElement>
+    Buffer<TElement> Buffer<TElement>::streaming(BufferType type, GLuint numElements, GLuint numRegions)
+    {
+        dassert(numElements > 0);
+        dassert(numRegions > 1); // the cpu writes one region while the gpu reads the others
+
+        Buffer<TElement> buffer;
+        buffer.m_type = type;
+        buffer.m_size = sizeof(TElement) * numElements;
+        // coherent: writes become visible to the gpu without explicit flushes
+        buffer.m_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glGenBuffers(1, &buffer.m_id);
+        glBindBuffer(static_cast<GLenum>(type), buffer.m_id);
+        glBufferStorage(static_cast<GLenum>(type), buffer.m_size, nullptr, buffer.m_flags);
+        buffer.m_mapped = static_cast<TElement*>(glMapBufferRange(static_cast<GLenum>(type), 0, buffer.m_size, buffer.m_flags));
+        if (!buffer.m_mapped)
+            throw std::runtime_error("Buffer::streaming could not map the buffer");
+
+        buffer.m_regionSize = (numElements + numRegions - 1) / numRegions;
+        buffer.m_fences.assign(numRegions, nullptr);
+        buffer.m_written.assign(numRegions, false);
+        return buffer;
+    }
+
     template <class TElement>
     Buffer<TElement>::~Buffer()
     {
+        for (GLsync fence : m_fences)
+        {
+            if (fence) glDeleteSync(fence);
+        }
         if (m_id)
         {
             glDeleteBuffers(1, &m_id);
@@ -198,6 +265,73 @@ namespace gpupro
         subDataUpdate(&data);
     }
 
+    template <class TElement>
+    TElement* Buffer<TElement>::streamReserve(GLuint count, GLuint& firstElement)
+    {
+        if (!m_mapped)
+            throw std::runtime_error("Buffer::streamReserve requires a streaming buffer");
+        if (count == 0 || count > getNumElements())
+            throw std::runtime_error("Buffer::streamReserve count does not fit into the buffer");
+
+        if (m_head + count > getNumElements())
+        {
+            // wrap around, the end of the ring stays unused in this round
+            m_head = 0;
+            m_currentRegion = GLuint(m_fences.size());
+        }
+
+        const GLuint first = m_head / m_regionSize;
+        const GLuint last = (m_head + count - 1) / m_regionSize;
+        for (GLuint region = first; region <= last; ++region)
+        {
+            // wait when entering a region, not while still writing the current one
+            if (region == m_currentRegion) continue;
+            // lapped the ring since the last fence: the draw calls of this round need a fence first
+            if (m_written[region]) streamFence();
+            waitRegion(region);
+        }
+        // mark only after all waits, a fence placed above must not cover the new elements
+        for (GLuint region = first; region <= last; ++region)
+        {
+            m_written[region] = true;
+        }
+        m_currentRegion = last;
+
+        firstElement = m_head;
+        m_head += count;
+        return m_mapped + firstElement;
+    }
+
+    template <class TElement>
+    void Buffer<TElement>::streamFence()
+    {
+        for (GLuint region = 0; region < m_fences.size(); ++region)
+        {
+            if (!m_written[region]) continue;
+            // the newer fence also covers the draw calls of the older one
+            if (m_fences[region]) glDeleteSync(m_fences[region]);
+            m_fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            m_written[region] = false;
+        }
+    }
+
+    template <class TElement>
+    void Buffer<TElement>::waitRegion(GLuint region)
+    {
+        GLsync fence = m_fences[region];
+        if (!fence) return;
+        // flush once so the fence is guaranteed to be signaled eventually
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;)
+        {
+            const GLenum result = glClientWaitSync(fence, flags, 1000000); // 1 ms
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+            flags = 0;
+        }
+        glDeleteSync(fence);
+        m_fences[region] = nullptr;
+    }
+
     template <class TElement>
     void Buffer<TElement>::subDataUpdate(const void* data)
     {
@@ -59,6 +59,15 @@ gpupro::VertexArray& gpupro::VertexArray::addBinding(GLuint bindingIndex, GLuint
     return *this;
 }
 
+gpupro::VertexArray& gpupro::VertexArray::setDivisor(GLuint bindingIndex, GLuint divisor)
+{
+    glBindVertexArray(m_id); // activate binding
+    dassert(bindingIndex < GLuint(getOpenglConstant<int>(GL_MAX_VERTEX_ATTRIB_BINDINGS)));
+    glVertexBindingDivisor(bindingIndex, divisor);
+    glBindVertexArray(0); // deactivate binding
+    return *this;
+}
+
 void gpupro::VertexArray::bind() const
 {
     glBindVertexArray(m_id);
@@ -41,6 +41,11 @@ namespace gpupro
         VertexArray& addBinding(GLuint bindingIndex, GLuint attributeIndex, VertexType type, GLuint numComponents,
                                 GLuint offset = 0);
 
+        /// advances the attributes of a binding per instance instead of per vertex
+        /// \param bindingIndex cpu side binding index (from Buffer::bindAsVertexBuffer(X))
+        /// \param divisor number of instances that share one element (0 = per vertex)
+        VertexArray& setDivisor(GLuint bindingIndex, GLuint divisor);
+
         /// sets this vertex array as active vertex array
         void bind() const;
     private: